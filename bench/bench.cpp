@@ -0,0 +1,313 @@
+// mgs-bench: sweeps every generator and solver over a range of maze sizes
+// and seeds, printing the results as JSON.
+
+#include "maze.hpp"
+#include "solver.hpp"
+#include "catalog.hpp"
+#include "generator.hpp"
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+////////////////////////////////
+// Allocation tracking
+////////////////////////////////
+
+// Every allocation carries a header with its size so that live and peak
+// heap bytes can be tracked per benchmark case.
+static constexpr size_t HEADER = alignof(std::max_align_t);
+static std::atomic<size_t> s_allocs{0};
+static std::atomic<size_t> s_live{0};
+static std::atomic<size_t> s_peak{0};
+
+static void *Allocate(size_t n)
+{
+    auto p = (char *)malloc(n + HEADER);
+    if (!p)
+        throw std::bad_alloc();
+    *(size_t *)p = n;
+
+    s_allocs ++;
+    size_t live = s_live += n;
+    size_t peak = s_peak;
+    while (live > peak && !s_peak.compare_exchange_weak(peak, live));
+    return p + HEADER;
+}
+
+static void Release(void *p)
+{
+    if (!p)
+        return;
+    auto b = (char *)p - HEADER;
+    s_live -= *(size_t *)b;
+    free(b);
+}
+
+void *operator new  (size_t n) { return Allocate(n); }
+void *operator new[](size_t n) { return Allocate(n); }
+void operator delete  (void *p) noexcept { Release(p); }
+void operator delete[](void *p) noexcept { Release(p); }
+void operator delete  (void *p, size_t) noexcept { Release(p); }
+void operator delete[](void *p, size_t) noexcept { Release(p); }
+
+static size_t MaxResidentKB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+#endif
+}
+
+////////////////////////////////
+// Measurement
+////////////////////////////////
+
+struct Config {
+    unsigned sizes[16] = {51, 255, 511, 1023};
+    unsigned nsizes = 4;
+    unsigned seeds  = 3;
+    unsigned warmup = 1;
+    unsigned reps   = 5;
+    unsigned threads = 0;
+    const char *out = nullptr;
+};
+
+struct Sample {
+    double ns;         // wall time of one run
+    size_t allocs;     // allocations made by one run
+    size_t peak;       // peak heap bytes above the live bytes at the start
+};
+
+struct Summary {
+    double min, median, mean;
+    size_t allocs, peak;
+};
+
+// Runs setup + body warmup times untimed, then reps times timed. Only body
+// is measured, setup restores whatever state body consumes.
+template <typename S, typename B>
+static Summary Measure(const Config &cfg, S setup, B body)
+{
+    using clock = std::chrono::steady_clock;
+    Sample samples[64];
+    unsigned reps = std::min(cfg.reps, 64u);
+
+    for (unsigned i = 0; i < cfg.warmup; i ++) {
+        setup();
+        body();
+    }
+
+    for (unsigned i = 0; i < reps; i ++) {
+        setup();
+        size_t allocs = s_allocs, live = s_live;
+        s_peak = live;
+
+        auto t0 = clock::now();
+        body();
+        std::chrono::duration<double, std::nano> d = clock::now() - t0;
+
+        samples[i] = {d.count(), s_allocs - allocs, s_peak - live};
+    }
+
+    std::sort(samples, samples + reps, [](const Sample &a, const Sample &b) {
+        return a.ns < b.ns;
+    });
+
+    Summary s = {};
+    s.min = samples[0].ns;
+    s.median = samples[reps / 2].ns;
+    for (unsigned i = 0; i < reps; i ++) {
+        s.mean += samples[i].ns / reps;
+        s.allocs = std::max(s.allocs, samples[i].allocs);
+        s.peak   = std::max(s.peak, samples[i].peak);
+    }
+    return s;
+}
+
+////////////////////////////////
+// Output
+////////////////////////////////
+
+static FILE *s_out = stdout;
+static bool s_first = true;
+
+static void BeginResult(const char *kind, const char *name, const Maze &maze, unsigned long long seed)
+{
+    fprintf(s_out, "%s\n    {\"kind\": \"%s\", \"name\": \"%s\", \"width\": %u, \"height\": %u, \"seed\": %llu",
+            s_first ? "" : ",", kind, name, maze.hcells, maze.vcells, seed);
+    s_first = false;
+}
+
+static void WriteSummary(const Summary &s, double cells)
+{
+    fprintf(s_out, ", \"ns_per_cell\": {\"min\": %.4f, \"median\": %.4f, \"mean\": %.4f}",
+            s.min / cells, s.median / cells, s.mean / cells);
+    fprintf(s_out, ", \"ms\": {\"min\": %.4f, \"median\": %.4f, \"mean\": %.4f}",
+            s.min * 1e-6, s.median * 1e-6, s.mean * 1e-6);
+    fprintf(s_out, ", \"allocs\": %zu, \"peak_bytes\": %zu", s.allocs, s.peak);
+}
+
+////////////////////////////////
+// Heuristic kernels
+////////////////////////////////
+
+// The heuristics of the catalog again, at other addresses. Solver only
+// compiles its kernels for the functions in Heuristics, given these it
+// runs the generic kernel calling through the pointer, as it did before
+// the kernels were specialized.
+static float GenericNone(int x0, int y0, int x1, int y1)      { return Heuristics::None(x0, y0, x1, y1); }
+static float GenericManhattan(int x0, int y0, int x1, int y1) { return Heuristics::Manhattan(x0, y0, x1, y1); }
+static float GenericEuclidean(int x0, int y0, int x1, int y1) { return Heuristics::Euclidean(x0, y0, x1, y1); }
+
+// by index into Catalog::heuristics
+static const Solver::Heuristic GENERIC[] = {GenericNone, GenericManhattan, GenericEuclidean};
+static_assert(sizeof(GENERIC) / sizeof(*GENERIC) == Catalog::Count(Catalog::heuristics), "one per heuristic");
+
+// Solvers with a kernel per heuristic, run both ways.
+static bool Specialized(Solver::Type t)
+{
+    return t == Solver::AStar || t == Solver::GreedyBestFirst
+        || t == Solver::BidirectionalAStar || t == Solver::JumpPoint;
+}
+
+////////////////////////////////
+// Main
+////////////////////////////////
+
+static void Usage()
+{
+    fprintf(stderr,
+        "usage: mgs-bench [options]\n"
+        "  --sizes A,B,...   odd maze sizes, each maze is square (default 51,255,511,1023)\n"
+        "  --seeds N         seeds per size, seeds are 1..N (default 3)\n"
+        "  --warmup N        untimed runs before measuring (default 1)\n"
+        "  --reps N          timed runs per case, at most 64 (default 5)\n"
+        "  --threads N       workers of the parallel solvers, 0 for one per core\n"
+        "  --out FILE        write JSON to FILE instead of stdout\n");
+}
+
+static bool ParseArgs(int argc, char **argv, Config &cfg)
+{
+    for (int i = 1; i < argc; i ++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[++ i] : nullptr;
+        if (!v)
+            return false;
+
+        if (!strcmp(a, "--sizes")) {
+            cfg.nsizes = 0;
+            for (char *e = (char *)v; *e && cfg.nsizes < 16; e += *e == ',') {
+                char *n = e;
+                cfg.sizes[cfg.nsizes ++] = strtoul(n, &e, 10) | 1;
+                if (e == n)
+                    return false;
+            }
+        } else if (!strcmp(a, "--seeds")) {
+            cfg.seeds = strtoul(v, nullptr, 10);
+        } else if (!strcmp(a, "--warmup")) {
+            cfg.warmup = strtoul(v, nullptr, 10);
+        } else if (!strcmp(a, "--reps")) {
+            cfg.reps = std::min(strtoul(v, nullptr, 10), 64ul);
+        } else if (!strcmp(a, "--threads")) {
+            cfg.threads = strtoul(v, nullptr, 10);
+        } else if (!strcmp(a, "--out")) {
+            cfg.out = v;
+        } else {
+            return false;
+        }
+    }
+    return cfg.nsizes && cfg.reps;
+}
+
+int main(int argc, char **argv)
+{
+    using namespace Catalog;
+
+    Config cfg;
+    if (!ParseArgs(argc, argv, cfg)) {
+        Usage();
+        return 1;
+    }
+
+    if (cfg.out && !(s_out = fopen(cfg.out, "w"))) {
+        fprintf(stderr, "mgs-bench: cannot open %s\n", cfg.out);
+        return 1;
+    }
+
+    fprintf(s_out, "{\n  \"version\": 1,\n  \"warmup\": %u,\n  \"reps\": %u,\n  \"threads\": %u,\n  \"results\": [",
+            cfg.warmup, cfg.reps, cfg.threads);
+
+    Generator generator;
+    // one solver over every maze, its caches tell them apart by Maze::id
+    Solver solver;
+    solver.threads = cfg.threads;
+
+    for (unsigned si = 0; si < cfg.nsizes; si ++) {
+        Maze maze(cfg.sizes[si], cfg.sizes[si]);
+        double cells = (double)maze.hcells * maze.vcells;
+
+        for (int g = 0; g < Count(generators); g ++) {
+            for (unsigned long long seed = 1; seed <= cfg.seeds; seed ++) {
+                auto generate = [&] {
+                    generator.Init(&maze, generators[g].type, seed);
+                    while (generator.Step(UINT_MAX));
+                };
+
+                auto gs = Measure(cfg, [] {}, generate);
+                BeginResult("generator", generators[g].name, maze, seed);
+                WriteSummary(gs, cells);
+                fprintf(s_out, "}");
+
+                generate();
+
+                for (int s = 0; s < Count(solvers); s ++) {
+                    bool both = Specialized(solvers[s].type);
+                    for (int h = 0; h < (solvers[s].informed ? Count(heuristics) : 1); h ++) {
+                        for (int generic = 0; generic <= both; generic ++) {
+                            auto func = generic ? GENERIC[h] : heuristics[h].func;
+                            auto ss = Measure(cfg, [&] { maze.ClearPaths(); }, [&] {
+                                solver.Init(&maze, solvers[s].type, func);
+                                while (solver.Step(UINT_MAX));
+                            });
+
+                            BeginResult("solver", solvers[s].name, maze, seed);
+                            fprintf(s_out, ", \"generator\": \"%s\", \"heuristic\": \"%s\"",
+                                    generators[g].name, heuristics[h].name);
+                            if (both)
+                                fprintf(s_out, ", \"kernel\": \"%s\"", generic ? "generic" : "specialized");
+                            WriteSummary(ss, cells);
+                            fprintf(s_out, ", \"path_length\": %u, \"expansions\": %u, \"expansions_per_sec\": %.0f}",
+                                    solver.pathLength, solver.vertsExpanded,
+                                    solver.vertsExpanded / (ss.median * 1e-9));
+                        }
+                    }
+                }
+                fflush(s_out);
+            }
+        }
+    }
+
+    fprintf(s_out, "\n  ],\n  \"max_rss_kb\": %zu\n}\n", MaxResidentKB());
+    if (s_out != stdout)
+        fclose(s_out);
+    return 0;
+}
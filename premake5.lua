@@ -1,4 +1,9 @@
 -- premake.lua
+newoption {
+  trigger = "avx2",
+  description = "Build the bitset kernels with AVX2, they use SSE2 otherwise"
+}
+
 workspace "dsa-project"
   configurations {"debug", "release"}
   architecture "x86_64"
@@ -11,6 +16,9 @@ workspace "dsa-project"
     optimize "On"
     defines "NDEBUG"
 
+  filter "options:avx2"
+    vectorextensions "AVX2"
+
   filter {}
 
 project "mgs"
@@ -38,7 +46,7 @@ project "mgs"
   includedirs { "./extern/imgui", "./extern/imgui_impl_sdl2" }
 
   filter "not system:windows"
-    links { "SDL2", "SDL2main" }
+    links { "SDL2", "SDL2main", "pthread" }
 
   filter "system:windows"
     includedirs { "./extern/SDL2-2.26.1/" }
@@ -48,3 +56,28 @@ project "mgs"
     postbuildcommands { "copy ..\\extern\\SDL2-2.26.1\\lib\\x64\\SDL2.dll .\\%{cfg.buildcfg}\\" }
 
   filter {}
+
+project "mgs-bench"
+  kind "ConsoleApp"
+  language "C++"
+  cppdialect "C++17"
+
+  location "%{wks.location}/build"
+  targetdir "%{prj.location}/%{cfg.buildcfg}"
+  objdir "%{prj.location}/%{cfg.buildcfg}/obj/bench"
+
+  files { "%{wks.location}/bench/**.cpp", "%{wks.location}/source/**.cpp", "%{wks.location}/source/**.hpp" }
+  removefiles {
+    "%{wks.location}/source/main.cpp",
+    "%{wks.location}/source/application.*",
+    "%{wks.location}/source/renderer.*"
+  }
+  includedirs { "%{wks.location}/source" }
+
+  filter "not system:windows"
+    links { "pthread" }
+
+  filter "system:windows"
+    links { "psapi" }
+
+  filter {}
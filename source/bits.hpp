@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Bits {
+    // index of the lowest set bit, w must not be zero
+    inline unsigned LowestSet(uint64_t w) {
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward64(&i, w);
+        return i;
+#else
+        return __builtin_ctzll(w);
+#endif
+    }
+
+    // index of the highest set bit, w must not be zero
+    inline unsigned HighestSet(uint64_t w) {
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanReverse64(&i, w);
+        return i;
+#else
+        return 63 - __builtin_clzll(w);
+#endif
+    }
+
+    inline unsigned Count(uint64_t w) {
+#ifdef _MSC_VER
+        return (unsigned)__popcnt64(w);
+#else
+        return __builtin_popcountll(w);
+#endif
+    }
+
+    // moves bit i of w to bit 2i, the layout of a two bit per cell plane
+    inline uint64_t Spread(uint32_t w) {
+        uint64_t x = w;
+        x = (x | x << 16) & 0x0000ffff0000ffffull;
+        x = (x | x << 8)  & 0x00ff00ff00ff00ffull;
+        x = (x | x << 4)  & 0x0f0f0f0f0f0f0f0full;
+        x = (x | x << 2)  & 0x3333333333333333ull;
+        x = (x | x << 1)  & 0x5555555555555555ull;
+        return x;
+    }
+
+    // mask of the cells of a row that live in word i, clearing the padding
+    // bits past the last column
+    inline uint64_t RowMask(unsigned i, unsigned stride, unsigned width) {
+        return i + 1 < stride || !(width & 63) ? ~(uint64_t)0 : ((uint64_t)1 << (width & 63)) - 1;
+    }
+}
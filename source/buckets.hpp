@@ -0,0 +1,58 @@
+#pragma once
+
+#include <assert.h>
+#include "stack.hpp"
+
+// Monotone integer priority queue after Dial. Keys are kept in N buckets
+// by key modulo N, which works as long as no key is pushed below the last
+// one popped or N or more above it. Until the first pop after Clear, the
+// first key pushed stands in for the last popped. Push is O(1) and Pop is O(1)
+// amortized, scanning at most N buckets. Within a key, the last pushed
+// comes out first.
+//
+// There is no decrease key: a better key is pushed again, and the caller
+// recognises and skips the entry left behind when it comes out.
+template <typename T, unsigned N = 16>
+class Buckets {
+public:
+    static_assert((N & (N - 1)) == 0, "bucket count is a power of two");
+
+    void Push(unsigned key, const T &item) {
+        if (fresh)
+            at = key, fresh = false;
+        assert(key >= at && key - at < N);
+        buckets[key & (N - 1)].Push(item);
+        size ++;
+    }
+
+    // Takes out an item of the smallest key, which is left in key.
+    T Pop(unsigned &key) {
+        assert(size);
+        while (buckets[at & (N - 1)].IsEmpty())
+            at ++;
+        size --;
+        key = at;
+        return buckets[at & (N - 1)].Pop();
+    }
+
+    bool IsEmpty() {
+        return size == 0;
+    }
+
+    unsigned Size() {
+        return size;
+    }
+
+    void Clear() {
+        for (auto &b : buckets)
+            b.Clear();
+        size = 0;
+        fresh = true;
+    }
+
+private:
+    Stack<T> buckets[N];
+    unsigned at = 0; // key of the bucket popped from
+    unsigned size = 0;
+    bool fresh = true; // nothing pushed since Clear
+};
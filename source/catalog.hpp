@@ -0,0 +1,71 @@
+#pragma once
+
+#include "solver.hpp"
+#include "generator.hpp"
+#include "heuristic.hpp"
+
+#include <string.h>
+
+// Short names of every algorithm, shared by the command line front ends.
+namespace Catalog {
+    struct GeneratorEntry {
+        const char *name;
+        Generator::Type type;
+    };
+
+    struct SolverEntry {
+        const char *name;
+        Solver::Type type;
+        bool informed;
+    };
+
+    struct HeuristicEntry {
+        const char *name;
+        Solver::Heuristic func;
+    };
+
+    inline const GeneratorEntry generators[] = {
+        {"random"  , Generator::Type::Random           },
+        {"dfs"     , Generator::Type::RandomizedDFS    },
+        {"division", Generator::Type::RecursiveDivision},
+        {"kruskal" , Generator::Type::RandomizedKruskal},
+        {"prim"    , Generator::Type::RandomizedPrim   },
+        {"eller"   , Generator::Type::Eller            },
+    };
+
+    inline const SolverEntry solvers[] = {
+        {"dfs"     , Solver::Type::DepthFirst     , false},
+        {"bfs"     , Solver::Type::BreadthFirst   , false},
+        {"dijkstra", Solver::Type::Dijkstra       , false},
+        {"astar"   , Solver::Type::AStar          , true },
+        {"greedy"  , Solver::Type::GreedyBestFirst, true },
+        {"bibfs"   , Solver::Type::BidirectionalBFS  , false},
+        {"biastar" , Solver::Type::BidirectionalAStar, true },
+        {"jps"     , Solver::Type::JumpPoint         , true },
+        {"pbfs"    , Solver::Type::ParallelBFS       , false},
+        {"wave"    , Solver::Type::Wavefront         , false},
+        {"field"   , Solver::Type::DistanceField     , false},
+        {"lpa"     , Solver::Type::LifelongAStar     , true },
+        {"hpa"     , Solver::Type::Hierarchical      , true },
+        {"junction", Solver::Type::Junction          , true },
+    };
+
+    inline const HeuristicEntry heuristics[] = {
+        {"none"     , Heuristics::None     },
+        {"manhattan", Heuristics::Manhattan},
+        {"euclidean", Heuristics::Euclidean},
+    };
+
+    template <typename T, int N>
+    constexpr int Count(const T (&)[N]) {
+        return N;
+    }
+
+    template <typename T, int N>
+    int Lookup(const T (&table)[N], const char *name) {
+        for (int i = 0; i < N; i ++)
+            if (!strcmp(table[i].name, name))
+                return i;
+        return -1;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <assert.h>
+
+// Disjoint set forest with path compression (halving) and union by rank.
+// Rank is an upper bound on the height of a tree, so MaxRank() bounds the
+// length of any Find walk.
+class DisjointSet {
+public:
+    DisjointSet() {}
+    ~DisjointSet() {
+        delete [] parent;
+        delete [] rank;
+    }
+
+    void Init(unsigned n) {
+        if (n > capacity) {
+            delete [] parent;
+            delete [] rank;
+            parent = new unsigned[n];
+            rank   = new unsigned char[n];
+            capacity = n;
+        }
+
+        for (unsigned i = 0; i < n; i ++) {
+            parent[i] = i;
+            rank[i] = 0;
+        }
+        count = sets = n;
+        maxRank = 0;
+    }
+
+    unsigned Find(unsigned x) {
+        assert(x < count);
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    // returns false if a and b were already in the same set
+    bool Union(unsigned a, unsigned b) {
+        a = Find(a);
+        b = Find(b);
+        if (a == b)
+            return false;
+
+        if (rank[a] < rank[b]) {
+            auto t = a; a = b; b = t;
+        }
+
+        parent[b] = a;
+        if (rank[a] == rank[b] && ++ rank[a] > maxRank)
+            maxRank = rank[a];
+        sets --;
+        return true;
+    }
+
+    unsigned SetCount() { return sets; }
+    unsigned MaxRank()  { return maxRank; }
+
+private:
+    unsigned *parent = nullptr;
+    unsigned char *rank = nullptr;
+    unsigned capacity = 0;
+    unsigned count = 0;
+    unsigned sets = 0;
+    unsigned maxRank = 0;
+};
@@ -0,0 +1,162 @@
+#include "eller.hpp"
+#include "bits.hpp"
+#include "rng.hpp"
+
+#include <string.h>
+
+// even bits of a word, the cell columns
+static const uint64_t CELLS = 0x5555555555555555ull;
+
+EllerStream::EllerStream(unsigned width, unsigned height, unsigned long long seed)
+    : width(width), height(height), stride((width + 63) / 64), seed(seed)
+{
+    m_cols = (width + 1) / 2;
+    _alloc();
+    for (unsigned c = 0; c < m_cols; c ++)
+        m_set[c] = c;
+}
+
+EllerStream::EllerStream(const EllerStream &e)
+{
+    _copy(e);
+}
+
+EllerStream &EllerStream::operator=(const EllerStream &e)
+{
+    if (this != &e)
+        _copy(e);
+    return *this;
+}
+
+EllerStream::~EllerStream()
+{
+    delete [] m_set;
+    delete [] m_count;
+    delete [] m_pick;
+    delete [] m_below;
+}
+
+void EllerStream::_alloc()
+{
+    delete [] m_set;
+    delete [] m_count;
+    delete [] m_pick;
+    delete [] m_below;
+    m_set   = new unsigned[m_cols];
+    m_count = new unsigned[m_cols];
+    m_pick  = new unsigned[m_cols];
+    m_below = new uint64_t[stride]();
+}
+
+void EllerStream::_copy(const EllerStream &e)
+{
+    width = e.width, height = e.height, stride = e.stride;
+    seed = e.seed, row = e.row;
+    m_cols = e.m_cols;
+    _alloc();
+    memcpy(m_set, e.m_set, m_cols * sizeof(*m_set));
+    memcpy(m_below, e.m_below, stride * sizeof(*m_below));
+}
+
+bool EllerStream::Next(uint64_t *walls)
+{
+    if (row >= height)
+        return false;
+
+    if (row & 1)
+        memcpy(walls, m_below, stride * sizeof(*walls));
+    else
+        _cellRow(walls);
+    row ++;
+    return true;
+}
+
+void EllerStream::Seek(unsigned y)
+{
+    if (y < row) {
+        row = 0;
+        for (unsigned c = 0; c < m_cols; c ++)
+            m_set[c] = c;
+    }
+    for (; row < y; row ++)
+        if (!(row & 1))
+            _cellRow(nullptr);
+}
+
+// Joins neighbouring cells of different sets at random, the whole row
+// when it is the last one, then sends every set down at least once. The
+// cells below that were not reached from above start sets of their own,
+// under set numbers left free.
+void EllerStream::_cellRow(uint64_t *walls)
+{
+    unsigned k = row / 2;
+    bool last = row + 2 >= height;
+    RNG::Stream rng;
+    rng.Seed(seed, k);
+
+    // coin flips come 32 to a draw
+    uint32_t flips = 0;
+    unsigned nflips = 0;
+    auto coin = [&rng, &flips, &nflips] {
+        if (!nflips)
+            flips = rng.Get(), nflips = 32;
+        bool heads = flips & 1;
+        flips >>= 1;
+        nflips --;
+        return heads;
+    };
+
+    for (unsigned i = 0; i < stride; i ++) {
+        m_below[i] = Bits::RowMask(i, stride, width);
+        if (walls)
+            walls[i] = m_below[i] & ~CELLS;
+    }
+
+    m_sets.Init(m_cols);
+    for (unsigned c = 0; c + 1 < m_cols; c ++) {
+        if ((last || coin()) && m_sets.Union(m_set[c], m_set[c + 1]) && walls) {
+            unsigned x = 2 * c + 1;
+            walls[x >> 6] &= ~((uint64_t)1 << (x & 63));
+        }
+    }
+    if (last)
+        return;
+
+    // every cell flips a coin to go down, sets where none did count their
+    // cells and send one picked at random in a second pass
+    for (unsigned c = 0; c < m_cols; c ++)
+        m_count[c] = 0, m_pick[c] = ~0u;
+    for (unsigned c = 0; c < m_cols; c ++) {
+        unsigned s = m_set[c] = m_sets.Find(m_set[c]);
+        unsigned x = 2 * c;
+        uint64_t down = coin();
+        m_below[x >> 6] &= ~(down << (x & 63));
+        unsigned n = m_count[s];
+        m_count[s] = down ? ~0u : n + (n != ~0u);
+    }
+
+    // m_count now also marks the set numbers still in use below
+    for (unsigned c = 0; c < m_cols; c ++) {
+        unsigned s = m_set[c];
+        if (m_count[s] == ~0u)
+            continue;
+        if (m_pick[s] == ~0u)
+            m_pick[s] = rng.Get() % m_count[s];
+        if (!m_pick[s] --) {
+            unsigned x = 2 * c;
+            m_below[x >> 6] &= ~((uint64_t)1 << (x & 63));
+            m_count[s] = ~0u;
+        }
+    }
+
+    unsigned free = 0;
+    for (unsigned c = 0; c < m_cols; c ++) {
+        unsigned x = 2 * c;
+        if (!((m_below[x >> 6] >> (x & 63)) & 1))
+            continue;
+        while (m_count[free] == ~0u)
+            free ++;
+        m_set[c] = free;
+        m_count[free] = ~0u;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include "dset.hpp"
+
+// Eller's algorithm, emitting a grid maze one row at a time in memory
+// proportional to its width, so the height is only bounded by the row
+// counter. Rows come out as wall bits laid out like a row of Maze::walls,
+// cells on even coordinates as with the other generators.
+//
+// Each cell row draws from a random stream of its own, selected by the
+// seed and the row, so the walls of a row only depend on the sets the row
+// starts out with. A copy is a checkpoint from which any later range of
+// rows can be regenerated, Seek replays the rows in between without
+// writing them.
+class EllerStream {
+public:
+     EllerStream(unsigned width, unsigned height, unsigned long long seed);
+     EllerStream(const EllerStream &e);
+    ~EllerStream();
+
+    EllerStream &operator=(const EllerStream &e);
+
+    // Writes row `row` into stride words and moves to the next one,
+    // returns false once all rows are out.
+    bool Next(uint64_t *walls);
+    void Seek(unsigned y);
+
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned stride = 0;
+    unsigned long long seed = 0;
+    unsigned row = 0; // next row Next writes
+
+private:
+    unsigned m_cols = 0;         // cells per cell row
+    unsigned *m_set = nullptr;   // set of each cell of the next cell row
+    unsigned *m_count = nullptr; // per set, cells that did not go down
+    unsigned *m_pick = nullptr;  // per set, countdown to the one sent anyway
+    uint64_t *m_below = nullptr; // walls of the row under the last cell row
+    DisjointSet m_sets;
+
+    void _alloc();
+    void _copy(const EllerStream &e);
+    void _cellRow(uint64_t *walls);
+};
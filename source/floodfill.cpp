@@ -0,0 +1,322 @@
+#include "floodfill.hpp"
+#include "maze.hpp"
+#include "bits.hpp"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FLOOD_LANES 4
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FLOOD_LANES 2
+#else
+#define FLOOD_LANES 1
+#endif
+
+// next = (f | f << 1 | f >> 1 | up | down) & free over the words [lo, hi]
+// of a row, then free &= ~next. lo and hi + 1 are multiples of
+// FLOOD_LANES, f[lo - 1] and f[hi + 1] are readable.
+static void Expand(const uint64_t *f, const uint64_t *up, const uint64_t *down,
+                   uint64_t *free, uint64_t *next, unsigned lo, unsigned hi)
+{
+#if FLOOD_LANES == 4
+    for (unsigned i = lo; i <= hi; i += 4) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(f + i));
+        __m256i l = _mm256_loadu_si256((const __m256i *)(f + i - 1));
+        __m256i r = _mm256_loadu_si256((const __m256i *)(f + i + 1));
+        __m256i h = _mm256_or_si256(c, _mm256_slli_epi64(c, 1));
+        h = _mm256_or_si256(h, _mm256_srli_epi64(l, 63));
+        h = _mm256_or_si256(h, _mm256_srli_epi64(c, 1));
+        h = _mm256_or_si256(h, _mm256_slli_epi64(r, 63));
+        h = _mm256_or_si256(h, _mm256_loadu_si256((const __m256i *)(up + i)));
+        h = _mm256_or_si256(h, _mm256_loadu_si256((const __m256i *)(down + i)));
+
+        __m256i e = _mm256_loadu_si256((const __m256i *)(free + i));
+        __m256i n = _mm256_and_si256(h, e);
+        _mm256_storeu_si256((__m256i *)(next + i), n);
+        _mm256_storeu_si256((__m256i *)(free + i), _mm256_xor_si256(e, n));
+    }
+#elif FLOOD_LANES == 2
+    for (unsigned i = lo; i <= hi; i += 2) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(f + i));
+        __m128i l = _mm_loadu_si128((const __m128i *)(f + i - 1));
+        __m128i r = _mm_loadu_si128((const __m128i *)(f + i + 1));
+        __m128i h = _mm_or_si128(c, _mm_slli_epi64(c, 1));
+        h = _mm_or_si128(h, _mm_srli_epi64(l, 63));
+        h = _mm_or_si128(h, _mm_srli_epi64(c, 1));
+        h = _mm_or_si128(h, _mm_slli_epi64(r, 63));
+        h = _mm_or_si128(h, _mm_loadu_si128((const __m128i *)(up + i)));
+        h = _mm_or_si128(h, _mm_loadu_si128((const __m128i *)(down + i)));
+
+        __m128i e = _mm_loadu_si128((const __m128i *)(free + i));
+        __m128i n = _mm_and_si128(h, e);
+        _mm_storeu_si128((__m128i *)(next + i), n);
+        _mm_storeu_si128((__m128i *)(free + i), _mm_xor_si128(e, n));
+    }
+#else
+    for (unsigned i = lo; i <= hi; i ++) {
+        uint64_t h = f[i] | f[i] << 1 | (f - 1)[i] >> 63 | f[i] >> 1 | (f + 1)[i] << 63 | up[i] | down[i];
+        next[i] = h & free[i];
+        free[i] ^= next[i];
+    }
+#endif
+}
+
+FloodFill::~FloodFill() {_reset();}
+
+void FloodFill::_reset()
+{
+    _release();
+    delete [] m_free;
+    delete [] m_phase;
+    delete [] m_dist;
+    m_free = m_phase = nullptr;
+    m_dist = nullptr;
+}
+
+// Frees what only the fill itself needs, once it is done.
+void FloodFill::_release()
+{
+    delete [] m_front;
+    delete [] m_rowBuf;
+    delete [] m_spans;
+    delete [] m_nspans;
+    delete [] m_rows;
+    delete [] m_nrows;
+    delete [] m_stamp;
+    m_front = m_rowBuf = nullptr;
+    m_spans = m_nspans = nullptr;
+    m_rows = m_nrows = m_stamp = nullptr;
+    m_nactive = 0;
+}
+
+void FloodFill::Init(Maze *maze, unsigned flags)
+{
+    _reset();
+    m_maze = maze;
+    m_flags = maze->marks ? flags : flags & ~MARK;
+    m_width = maze->hcells;
+    m_height = maze->vcells;
+    wave = 0;
+    reached = 0;
+
+    // whole vectors per row, plus the two guard words
+    unsigned words = (maze->stride + FLOOD_LANES - 1) / FLOOD_LANES * FLOOD_LANES;
+    m_pitch = words + 2;
+    size_t n = (size_t)m_pitch * (m_height + 2);
+    m_free  = new uint64_t[n]();
+    m_front = new uint64_t[n]();
+    m_phase = new uint64_t[n]();
+    m_rowBuf = new uint64_t[3 * m_pitch]();
+
+    for (unsigned y = 0; y < m_height; y ++) {
+        uint64_t *e = _row(m_free, y);
+        const uint64_t *w = maze->walls + (size_t)y * maze->stride;
+        for (unsigned i = 0; i < maze->stride; i ++)
+            e[i] = ~w[i] & Bits::RowMask(i, maze->stride, m_width);
+    }
+
+    if (m_flags & DISTANCES) {
+        m_dist = new uint32_t[(size_t)m_width * m_height];
+        memset(m_dist, 0xff, (size_t)m_width * m_height * sizeof(*m_dist));
+    }
+
+    m_spans  = new Span[m_height];
+    m_nspans = new Span[m_height];
+    m_rows   = new unsigned[m_height];
+    m_nrows  = new unsigned[m_height];
+    m_stamp  = new unsigned[m_height];
+    for (unsigned y = 0; y < m_height; y ++) {
+        m_spans[y] = m_nspans[y] = {1, 0};
+        m_stamp[y] = 0;
+    }
+
+    int x = m_flags & FROM_END ? maze->end.x : maze->start.x;
+    int y = m_flags & FROM_END ? maze->end.y : maze->start.y;
+    m_origin = {x, y};
+    if (maze->IsWall(x, y)) {
+        _release();
+        return;
+    }
+
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    _row(m_front, y)[x >> 6] |= bit;
+    _row(m_free , y)[x >> 6] &= ~bit;
+    m_spans[y] = {(unsigned)x >> 6, (unsigned)x >> 6};
+    m_rows[m_nactive ++] = y;
+    if (m_dist)
+        m_dist[(size_t)y * m_width + x] = 0;
+    reached = 1;
+    if (m_flags & MARK)
+        (*m_maze)(x, y) = ACTIVE;
+}
+
+size_t FloodFill::Step()
+{
+    if (!m_nactive)
+        return 0;
+
+    wave ++;
+    unsigned nnext = 0;
+    size_t count = 0;
+    unsigned last = m_pitch - 3;
+    uint64_t phase = wave & 2 ? ~(uint64_t)0 : 0;
+
+    // Rows are visited in increasing order and the new frontier of a row
+    // replaces the old one in place. The row below still needs the old
+    // one, so it is kept in a scratch row, as is the new one while it is
+    // being computed.
+    uint64_t *next = m_rowBuf + 1;
+    uint64_t *prev = m_rowBuf + m_pitch + 1;
+    uint64_t *zero = m_rowBuf + 2 * m_pitch + 1;
+    Span saved = {1, 0};
+    unsigned last_y = ~0u;
+
+    for (unsigned a = 0; a < m_nactive; a ++) {
+        unsigned r = m_rows[a];
+        unsigned y0 = r ? r - 1 : 0;
+        unsigned y1 = r + 1 < m_height ? r + 1 : r;
+        for (unsigned y = y0; y <= y1; y ++) {
+            if (m_stamp[y] == wave)
+                continue;
+            m_stamp[y] = wave;
+
+            // the frontier words of this row and its neighbours, one word
+            // wider on both sides, rounded out to whole vectors
+            unsigned lo = ~0u, hi = 0;
+            for (unsigned k = y ? y - 1 : 0; k <= y + 1 && k < m_height; k ++) {
+                if (m_spans[k].lo > m_spans[k].hi)
+                    continue;
+                lo = m_spans[k].lo < lo ? m_spans[k].lo : lo;
+                hi = m_spans[k].hi > hi ? m_spans[k].hi : hi;
+            }
+            lo = lo ? (lo - 1) / FLOOD_LANES * FLOOD_LANES : 0;
+            hi = hi < last ? hi + 1 : last;
+            hi = hi / FLOOD_LANES * FLOOD_LANES + FLOOD_LANES - 1;
+
+            // an unvisited row above has no frontier in either wave
+            uint64_t *f = _row(m_front, y);
+            const uint64_t *up = last_y + 1 == y ? prev : zero;
+            Expand(f, up, f + m_pitch, _row(m_free, y), next, lo, hi);
+
+            for (unsigned i = saved.lo; i <= saved.hi; i ++)
+                prev[i] = 0;
+            saved = {lo, hi};
+            last_y = y;
+
+            uint64_t *ph = _row(m_phase, y);
+            Span s = {1, 0};
+            for (unsigned i = lo; i <= hi; i ++) {
+                uint64_t old = f[i], n = next[i];
+                prev[i] = old;
+                f[i] = n;
+                if (old && (m_flags & MARK))
+                    _mark(y, i, old, ACTIVE, DEAD);
+                if (!n)
+                    continue;
+
+                if (s.lo > s.hi)
+                    s.lo = i;
+                s.hi = i;
+                count += Bits::Count(n);
+                ph[i] |= n & phase;
+                if (m_flags & MARK)
+                    _mark(y, i, n, PATH, ACTIVE);
+                for (uint64_t d = m_dist ? n : 0; d; d &= d - 1)
+                    m_dist[(size_t)y * m_width + i * 64 + Bits::LowestSet(d)] = wave;
+            }
+            if (s.lo <= s.hi) {
+                m_nspans[y] = s;
+                m_nrows[nnext ++] = y;
+            }
+        }
+    }
+
+    for (unsigned i = saved.lo; i <= saved.hi; i ++)
+        prev[i] = 0;
+    for (unsigned a = 0; a < m_nactive; a ++)
+        m_spans[m_rows[a]] = {1, 0};
+
+    Span *s = m_spans; m_spans = m_nspans; m_nspans = s;
+    unsigned *r = m_rows; m_rows = m_nrows; m_nrows = r;
+    m_nactive = nnext;
+    reached += count;
+    if (!m_nactive)
+        _release();
+    return count;
+}
+
+// Moves the marks of the cells set in word i of row y from one state to
+// the other. Frontier words mostly hold a cell or two, dense ones are
+// spread to the two bit layout of the marks a word at a time.
+void FloodFill::_mark(unsigned y, unsigned i, uint64_t cells, CellState from, CellState to)
+{
+    size_t at = (size_t)y * m_width + i * 64;
+    unsigned flip = from ^ to;
+    uint8_t *marks = m_maze->marks;
+    m_maze->Touch(i * 64 + Bits::LowestSet(cells), y);
+    m_maze->Touch(i * 64 + Bits::HighestSet(cells), y);
+
+    if (Bits::Count(cells) <= 8) {
+        for (; cells; cells &= cells - 1) {
+            size_t c = at + Bits::LowestSet(cells);
+            marks[c >> 2] ^= flip << ((c & 3) << 1);
+        }
+        return;
+    }
+
+    unsigned shift = (at & 3) << 1;
+    uint64_t w[3] = {Bits::Spread(cells) * flip, Bits::Spread(cells >> 32) * flip, 0};
+    if (shift) {
+        w[2] = w[1] >> (64 - shift);
+        w[1] = w[1] << shift | w[0] >> (64 - shift);
+        w[0] = w[0] << shift;
+    }
+
+    // only bytes holding a marked cell are touched, the last row may end
+    // well inside the word
+    uint8_t *m = marks + (at >> 2);
+    for (unsigned k = 0; k < 3; k ++, m += 8)
+        for (unsigned b = 0; w[k]; b ++, w[k] >>= 8)
+            m[b] ^= (uint8_t)w[k];
+}
+
+size_t FloodFill::Run()
+{
+    while (Step());
+    return reached;
+}
+
+bool FloodFill::Reached(int x, int y)
+{
+    return m_free && !m_maze->IsWall(x, y) && !_bit(m_free, x, y);
+}
+
+unsigned FloodFill::Trace(int x, int y, CellState t, unsigned &cost)
+{
+    assert(Reached(x, y));
+    unsigned n = 0;
+    (*m_maze)(x, y) = t;
+    cost += m_maze->Weight(x, y);
+
+    // reached neighbours are at d - 1 or d + 1, which differ in bit 1
+    auto closer = [this](int x, int y, bool phase) {
+        return x >= 0 && y >= 0 && (unsigned)x < m_width && (unsigned)y < m_height
+            && Reached(x, y) && _bit(m_phase, x, y) == phase;
+    };
+
+    int parity = (m_origin.x + m_origin.y) & 1;
+    while (x != m_origin.x || y != m_origin.y) {
+        unsigned d = _bit(m_phase, x, y) << 1 | ((x + y + parity) & 1);
+        bool p = ((d + 3) >> 1) & 1;
+        if      (closer(x - 1, y, p)) x --;
+        else if (closer(x + 1, y, p)) x ++;
+        else if (closer(x, y - 1, p)) y --;
+        else                          y ++;
+        (*m_maze)(x, y) = t;
+        cost += m_maze->Weight(x, y);
+        n ++;
+    }
+    return n;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+struct Maze;
+enum CellState : unsigned char;
+
+// Breadth first wavefront over the wall bitset. Each wave grows the
+// frontier by one cell in every direction with shifts and ors on whole
+// words, AVX2 or SSE2 when the build targets them, and masks the result
+// with the open cells not reached yet. Only rows holding frontier cells,
+// and their neighbours, are visited, over the word span the frontier
+// covers.
+//
+// The wave a cell is reached in is its distance from the start. Grid
+// neighbours are always one step apart, and the parity of a distance is
+// that of the cell, so one more bit plane holding bit 1 of it is enough
+// to walk a shortest path back down. The full distance field costs a
+// write per cell and is kept only on request.
+class FloodFill {
+public:
+    static constexpr uint32_t NONE = ~0u;
+
+    enum Flags {
+        MARK      = 1, // mark reached cells ACTIVE, and DEAD once left behind
+        DISTANCES = 2, // keep the distance of every cell for Distance
+        FROM_END  = 4, // spread from the end of the maze instead of its start
+    };
+
+     FloodFill() {}
+    ~FloodFill();
+
+    void Init(Maze *maze, unsigned flags);
+    // Advances one wave and returns the number of cells it reached, 0
+    // once the fill is done.
+    size_t Step();
+    size_t Run();
+
+    bool Reached(int x, int y);
+    uint32_t Distance(int x, int y) {
+        assert(m_dist);
+        return m_dist[(size_t)y * m_width + x];
+    }
+    // Writes t along a shortest path from (x, y) back to where the fill
+    // started and returns its length, (x, y) must have been reached. Adds
+    // the weights of the cells of the path to cost.
+    unsigned Trace(int x, int y, CellState t, unsigned &cost);
+
+    unsigned wave = 0;
+    size_t reached = 0;
+
+private:
+    struct Span { unsigned lo, hi; };
+
+    Maze *m_maze = nullptr;
+    unsigned m_flags = 0;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    struct { int x, y; } m_origin = {0, 0};
+
+    // bit planes of m_pitch words per row, each row has a zero guard word
+    // on both ends and the plane a zero guard row above and below, so
+    // neighbour reads never need bounds checks
+    unsigned m_pitch = 0;
+    uint64_t *m_free = nullptr;   // open cells not reached yet
+    uint64_t *m_front = nullptr;
+    uint64_t *m_phase = nullptr;  // bit 1 of the distance
+    uint64_t *m_rowBuf = nullptr; // three scratch rows for Step
+    uint32_t *m_dist = nullptr;   // only m_free, m_phase and m_dist outlive the fill
+
+    // rows holding frontier cells and the word span they cover
+    Span *m_spans = nullptr;
+    Span *m_nspans = nullptr;
+    unsigned *m_rows = nullptr;
+    unsigned *m_nrows = nullptr;
+    unsigned m_nactive = 0;
+    unsigned *m_stamp = nullptr;
+
+    uint64_t *_row(uint64_t *plane, unsigned y) {
+        return plane + (size_t)(y + 1) * m_pitch + 1;
+    }
+
+    bool _bit(uint64_t *plane, int x, int y) {
+        return (_row(plane, y)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    void _mark(unsigned y, unsigned i, uint64_t cells, CellState from, CellState to);
+    void _reset();
+    void _release();
+};
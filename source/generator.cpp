@@ -1,48 +1,107 @@
 #include "generator.hpp"
+#include "eller.hpp"
 #include "rng.hpp"
 #include "maze.hpp"
 
 Generator:: Generator() {}
 Generator::~Generator() {_reset();}
 
-void Generator::Init(Maze *maze, Type type)
+void Generator::Init(Maze *maze, Type type, unsigned long long seed)
 {
     _reset();
+    RNG::Seed(seed);
     m_maze = maze;
+    m_type = type;
+    m_seed = seed;
+    m_finished = false;
 
-#define CASE(_NAME) case Type::_NAME : _init##_NAME(); _step = &Generator::_step##_NAME; break
+#define CASE(_NAME) case Type::_NAME : _init##_NAME(); break
     switch (type) {
         CASE(Random);
         CASE(RandomizedDFS);
         CASE(RecursiveDivision);
         CASE(RandomizedKruskal);
         CASE(RandomizedPrim);
+        CASE(Eller);
     };
 #undef CASE
 }
 
 bool Generator::Step()
 {
-    if ((this->*_step)()) {
-        return true;
-    } else {
-        (*m_maze)(m_maze->start.x, m_maze->start.y) = PATH;
-        (*m_maze)(m_maze->end  .x, m_maze->end  .y) = PATH;
-        _reset();
-        return false;
+    Step(1);
+    return !m_finished;
+}
+
+template <bool (Generator::*S)()>
+unsigned Generator::_run(unsigned n)
+{
+    unsigned i = 0;
+    while (i < n) {
+        i ++;
+        if (!(this->*S)()) {
+            _finish();
+            break;
+        }
+    }
+    return i;
+}
+
+unsigned Generator::Step(unsigned n)
+{
+    if (m_finished)
+        return 0;
+
+#define CASE(_NAME) case Type::_NAME : return _run<&Generator::_step##_NAME>(n)
+    switch (m_type) {
+        CASE(Random);
+        CASE(RandomizedDFS);
+        CASE(RecursiveDivision);
+        CASE(RandomizedKruskal);
+        CASE(RandomizedPrim);
+        CASE(Eller);
+    };
+#undef CASE
+    return 0;
+}
+
+unsigned Generator::RunFor(std::chrono::nanoseconds budget)
+{
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + budget;
+    unsigned total = 0, batch = 64;
+
+    while (!m_finished) {
+        total += Step(batch);
+        auto now = clock::now();
+        if (now >= deadline)
+            break;
+        // grow batches while far from the deadline to keep clock reads rare
+        if (deadline - now > budget / 2 && batch < (1u << 20))
+            batch <<= 1;
     }
+    return total;
+}
+
+void Generator::_finish()
+{
+    (*m_maze)(m_maze->start.x, m_maze->start.y) = PATH;
+    (*m_maze)(m_maze->end  .x, m_maze->end  .y) = PATH;
+    _reset();
+    m_finished = true;
 }
 
 void Generator::_reset()
 {
     m_maze = nullptr;
-    m_finished = false;
 
     delete [] m_graph.edges;
-    delete [] m_graph.verts;
     m_graph = {};
 
     m_stack.Clear();
+
+    delete m_eller;
+    m_eller = nullptr;
 }
 
 ////////////////////////////////
@@ -55,9 +114,9 @@ void Generator::_initRandom()
 
 bool Generator::_stepRandom()
 {
-    unsigned m = m_maze->hcells * m_maze->vcells - 1;
-    for (unsigned i = 0; i <= m; i ++)
-        m_maze->cells[i] = (RNG::Get() & 3) == 0 ? WALL : PATH;
+    for (unsigned y = 0; y < m_maze->vcells; y ++)
+        for (unsigned x = 0; x < m_maze->hcells; x ++)
+            m_maze->Set(x, y, (RNG::Get() & 3) == 0 ? WALL : PATH);
     return false;
 }
 
@@ -212,12 +271,13 @@ void Generator::_initRandomizedKruskal()
     m_maze->Fill(WALL);
     auto hhcells = m_maze->hcells >> 1;
     auto hvcells = m_maze->vcells >> 1;
-    m_graph.nverts  = ((hhcells + 1) * (hvcells + 1));
     m_graph.nedges  = (hvcells * hhcells * 2) + hhcells + hvcells;
 
     m_graph.at = 0;
     m_graph.edges = new Edge[m_graph.nedges];
-    m_graph.verts = new unsigned[m_graph.nedges];
+    m_sets.Init((hhcells + 1) * (hvcells + 1));
+    setCount  = m_sets.SetCount();
+    setHeight = 0;
 
     unsigned i = 0;
     for (int x = 0; x < (int)m_maze->hcells - 2; x += 2)
@@ -228,9 +288,6 @@ void Generator::_initRandomizedKruskal()
         for (int x = 0; x < (int)m_maze->hcells; x += 2)
             m_graph.edges[i++] = {x, y, x, y + 2};
 
-    for (unsigned i = 0; i < m_graph.nverts; i ++)
-        m_graph.verts[i] = i;
-
     RNG::Shuffle(m_graph.nedges, m_graph.edges);
 }
 
@@ -238,22 +295,19 @@ bool Generator::_stepRandomizedKruskal()
 {
     auto hhcells = m_maze->hcells >> 1;
     Edge e;
-    unsigned v0, v1, f0, f1;
+    unsigned v0, v1;
 
     do {
-        if (m_graph.at >= m_graph.nedges)
+        if (m_graph.at >= m_graph.nedges || m_sets.SetCount() == 1)
             return false;
 
         e  = m_graph.edges[m_graph.at ++];
         v0 = (e.y0 / 2) * (hhcells + 1) + (e.x0 / 2);
         v1 = (e.y1 / 2) * (hhcells + 1) + (e.x1 / 2);
-        f0 = m_graph.verts[v0];
-        f1 = m_graph.verts[v1];
-    } while (f0 == f1);
+    } while (!m_sets.Union(v0, v1));
 
-    for (unsigned i = 0; i < m_graph.nverts; i++)
-        if (m_graph.verts[i] == f1)
-            m_graph.verts[i] = f0;
+    setCount  = m_sets.SetCount();
+    setHeight = m_sets.MaxRank();
 
     (*m_maze)(e.x0, e.y0) = PATH;
     (*m_maze)(e.x1, e.y1) = PATH;
@@ -271,7 +325,8 @@ void Generator::_initRandomizedPrim()
 
     auto hhcells = m_maze->hcells >> 1;
     auto hvcells = m_maze->vcells >> 1;
-    m_graph.edges = new Edge[hvcells * hhcells * 2 + hhcells + hvcells];
+    // every cell joins the maze once and pushes at most four edges
+    m_graph.edges = new Edge[(hhcells + 1) * (hvcells + 1) * 4];
 
     auto x = m_maze->start.x;
     auto y = m_maze->start.y;
@@ -326,3 +381,29 @@ bool Generator::_stepRandomizedPrim()
     addEdge(-2,  0);
     return true;
 }
+
+////////////////////////////////
+// Eller's
+////////////////////////////////
+
+// The streaming generator writing straight into the maze, a row per step.
+// It is seeded with the seed itself rather than from RNG, so the maze is
+// the one mgs --stream writes for the same seed, and any of its rows can
+// be written again from that seed alone.
+
+void Generator::_initEller()
+{
+    m_maze->Fill(WALL);
+    m_eller = new EllerStream(m_maze->hcells, m_maze->vcells, m_seed);
+}
+
+bool Generator::_stepEller()
+{
+    unsigned y = m_eller->row;
+    if (!m_eller->Next(m_maze->walls + (size_t)y * m_maze->stride))
+        return false;
+    m_maze->wallEdits ++;
+    m_maze->Touch(0, y);
+    m_maze->Touch(m_maze->hcells - 1, y);
+    return true;
+}
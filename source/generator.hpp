@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include "stack.hpp"
+#include "dset.hpp"
 
 struct Maze;
+class EllerStream;
 
 class Generator {
 public:
@@ -12,17 +15,30 @@ public:
         RecursiveDivision,
         RandomizedKruskal,
         RandomizedPrim,
+        Eller,
     };
 
      Generator();
     ~Generator();
 
-    void Init(Maze *maze, Type type);
+    // Seeds RNG, the maze only depends on the seed, its type and its size.
+    void Init(Maze *maze, Type type, unsigned long long seed);
     bool Step();
 
+    // Runs up to n steps, or as many as fit in budget, in one tight loop
+    // and returns how many ran.
+    unsigned Step(unsigned n);
+    unsigned RunFor(std::chrono::nanoseconds budget);
+    bool Finished() { return m_finished; }
+
+    unsigned setCount = 0;
+    unsigned setHeight = 0;
+
 private:
-    bool m_finished = false;
+    bool m_finished = true;
     Maze *m_maze = nullptr;
+    Type m_type = Random;
+    unsigned long long m_seed = 0;
 
     enum Direction : unsigned char {L, R, B, T};
     struct Edge { int x0, y0, x1, y1; };
@@ -42,24 +58,31 @@ private:
     Stack<Sitem> m_stack;
 
     struct {
-        unsigned nverts = 0, nedges = 0;
-        unsigned *verts = nullptr;
-        Edge     *edges = nullptr;
+        unsigned nedges = 0;
+        Edge    *edges = nullptr;
         unsigned at = 0;
     } m_graph;
 
+    DisjointSet m_sets;
+    EllerStream *m_eller = nullptr;
+
     void _reset();
+    void _finish();
+
+    template <bool (Generator::*S)()>
+    unsigned _run(unsigned n);
 
     void _initRandom();
     void _initRandomizedDFS();
     void _initRecursiveDivision();
     void _initRandomizedKruskal();
     void _initRandomizedPrim();
+    void _initEller();
 
-    bool (Generator::*_step)() = nullptr;
     bool _stepRandom();
     bool _stepRandomizedDFS();
     bool _stepRecursiveDivision();
     bool _stepRandomizedKruskal();
     bool _stepRandomizedPrim();
+    bool _stepEller();
 };
@@ -0,0 +1,198 @@
+#include "headless.hpp"
+#include "maze.hpp"
+#include "rng.hpp"
+#include "solver.hpp"
+#include "catalog.hpp"
+#include "generator.hpp"
+#include "eller.hpp"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void Usage()
+{
+    fprintf(stderr,
+        "usage: mgs --headless [options]\n"
+        "  --gen NAME        random, dfs, division, kruskal, prim, eller\n"
+        "                    (default kruskal)\n"
+        "  --solve NAME      none, dfs, bfs, dijkstra, astar, greedy, bibfs, biastar,\n"
+        "                    jps, pbfs, wave, field, lpa, hpa, junction\n"
+        "                    (default astar)\n"
+        "  --heuristic NAME  none, manhattan, euclidean (default manhattan)\n"
+        "  --size WxH        maze dimensions, rounded up to odd (default 51x51)\n"
+        "  --seed N          seed of the first run, run i uses N + i (default 1)\n"
+        "  --count N         number of runs (default 1)\n"
+        "  --threads N       workers of the parallel solvers, 0 for one per core\n"
+        "                    (default 0)\n"
+        "  --stream FILE     write an Eller's maze of --size and --seed to FILE, or -\n"
+        "                    for stdout, as PBM a row at a time instead of running\n"
+        "  --rows A:N        with --stream, only write rows A to A + N - 1\n"
+        "  --load FILE       solve the maze saved in FILE instead of generating,\n"
+        "                    gen_ms is then the time taken to load it\n"
+        "  --save FILE       save the maze of the last run to FILE\n"
+        "  --terrain N       give every cell a random terrain cost of 1 to N, which\n"
+        "                    dijkstra and astar find the cheapest path under\n"
+        "                    (default 1, no terrain)\n");
+}
+
+// Streams an Eller's maze into a binary PBM, walls black, holding no more
+// than a row of it at any time.
+static int Stream(const char *path, unsigned w, unsigned h, unsigned long long seed, unsigned first, unsigned rows)
+{
+    FILE *f = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+    if (!f) {
+        fprintf(stderr, "mgs: cannot open %s\n", path);
+        return 1;
+    }
+
+    EllerStream eller(w, h, seed);
+    eller.Seek(first < h ? first : h);
+    rows = first < h && rows > h - first ? h - first : rows;
+    rows = first < h ? rows : 0;
+    fprintf(f, "P4\n%u %u\n", w, rows);
+
+    // PBM rows are bytes, leftmost pixel in the high bit
+    unsigned n = (w + 7) / 8;
+    auto walls = new uint64_t[eller.stride];
+    auto line = new unsigned char[n];
+    for (unsigned y = 0; y < rows && eller.Next(walls); y ++) {
+        for (unsigned i = 0; i < n; i ++) {
+            uint64_t b = (walls[i >> 3] >> ((i & 7) << 3)) & 0xff;
+            line[i] = (b * 0x0202020202ull & 0x010884422010ull) % 1023;
+        }
+        if (w & 7)
+            line[n - 1] &= 0xff << (8 - (w & 7));
+        fwrite(line, 1, n, f);
+    }
+    delete [] walls;
+    delete [] line;
+
+    bool ok = !ferror(f);
+    if (f != stdout)
+        ok = !fclose(f) && ok;
+    if (!ok)
+        fprintf(stderr, "mgs: error writing %s\n", path);
+    return ok ? 0 : 1;
+}
+
+int RunHeadless(int argc, char **argv)
+{
+    using namespace Catalog;
+    int gen = Lookup(generators, "kruskal");
+    int sol = Lookup(solvers, "astar");
+    int heu = Lookup(heuristics, "manhattan");
+    unsigned w = 51, h = 51, count = 1, threads = 0, terrain = 1;
+    unsigned long long seed = 1;
+    const char *stream = nullptr;
+    const char *load = nullptr, *save = nullptr;
+    unsigned first = 0, rows = UINT_MAX;
+
+    for (int i = 1; i < argc; i ++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = true;
+
+        if (!strcmp(a, "--headless")) {
+            continue;
+        } else if (!strcmp(a, "--gen") && v) {
+            ok = (gen = Lookup(generators, v)) >= 0;
+        } else if (!strcmp(a, "--solve") && v) {
+            sol = strcmp(v, "none") ? Lookup(solvers, v) : Count(solvers);
+            ok = sol >= 0;
+        } else if (!strcmp(a, "--heuristic") && v) {
+            ok = (heu = Lookup(heuristics, v)) >= 0;
+        } else if (!strcmp(a, "--size") && v) {
+            ok = sscanf(v, "%ux%u", &w, &h) == 2 && w >= 3 && h >= 3;
+        } else if (!strcmp(a, "--seed") && v) {
+            seed = strtoull(v, nullptr, 10);
+        } else if (!strcmp(a, "--count") && v) {
+            count = strtoul(v, nullptr, 10);
+        } else if (!strcmp(a, "--threads") && v) {
+            threads = strtoul(v, nullptr, 10);
+        } else if (!strcmp(a, "--stream") && v) {
+            stream = v;
+        } else if (!strcmp(a, "--rows") && v) {
+            ok = sscanf(v, "%u:%u", &first, &rows) == 2;
+        } else if (!strcmp(a, "--load") && v) {
+            load = v;
+        } else if (!strcmp(a, "--save") && v) {
+            save = v;
+        } else if (!strcmp(a, "--terrain") && v) {
+            terrain = strtoul(v, nullptr, 10);
+            ok = terrain >= 1 && terrain <= Maze::MAX_WEIGHT;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "mgs: bad argument '%s%s%s'\n", a, v ? " " : "", v ? v : "");
+            Usage();
+            return 1;
+        }
+        i ++;
+    }
+
+    if (stream)
+        return Stream(stream, w | 1, h | 1, seed, first, rows);
+
+    Maze maze(w | 1, h | 1);
+    Generator generator;
+    Solver solver;
+    solver.threads = threads;
+
+    printf("run,seed,width,height,generator,solver,heuristic,gen_ms,solve_ms,found,path_length,verts_expanded,path_cost\n");
+    for (unsigned run = 0; run < count; run ++) {
+        using clock = std::chrono::steady_clock;
+        std::chrono::duration<double, std::milli> gms{0}, sms{0};
+
+        MazeInfo info = {generators[gen].type, seed + run};
+        const char *name = generators[gen].name;
+        RNG::Seed(seed + run);
+        auto t0 = clock::now();
+        if (load) {
+            if (!maze.Load(load, &info)) {
+                fprintf(stderr, "mgs: %s is not a maze file\n", load);
+                return 1;
+            }
+            name = "file";
+            for (auto &g : generators)
+                name = (int)g.type == info.generator ? g.name : name;
+        } else {
+            generator.Init(&maze, generators[gen].type, seed + run);
+            while (generator.Step(UINT_MAX));
+        }
+        gms = clock::now() - t0;
+
+        // drawn after the maze, which stays the one the seed gives
+        if (terrain > 1)
+            for (unsigned y = 0; y < maze.vcells; y ++)
+                for (unsigned x = 0; x < maze.hcells; x ++)
+                    maze.SetWeight(x, y, RNG::Get(1, terrain));
+
+        bool found = false;
+        if (sol < Count(solvers)) {
+            auto t1 = clock::now();
+            solver.Init(&maze, solvers[sol].type, heuristics[heu].func);
+            while (solver.Step(UINT_MAX));
+            sms = clock::now() - t1;
+            found = solver.found;
+        }
+
+        printf("%u,%llu,%u,%u,%s,%s,%s,%.3f,%.3f,%d,%u,%u,%u\n",
+                run, info.seed, maze.hcells, maze.vcells, name,
+                sol < Count(solvers) ? solvers[sol].name : "none",
+                heuristics[heu].name,
+                gms.count(), sms.count(), found,
+                solver.pathLength, solver.vertsExpanded, solver.pathCost);
+
+        if (save && run + 1 == count && !maze.Save(save, info)) {
+            fprintf(stderr, "mgs: cannot save %s\n", save);
+            return 1;
+        }
+    }
+
+    return 0;
+}
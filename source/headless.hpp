@@ -0,0 +1,5 @@
+#pragma once
+
+// Generates and solves mazes without creating a window, reporting one CSV
+// row per run on stdout. Returns the process exit code.
+int RunHeadless(int argc, char **argv);
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <assert.h>
+
+// Array backed d-ary min heap over integer ids in [0, n), where n is given to
+// Reserve. Every id is present at most once and its position in the heap is
+// tracked, so the key of a queued id can be changed in place with Update
+// and any queued id taken out with Remove.
+template <typename K, unsigned D = 4>
+class Heap {
+public:
+    static constexpr unsigned NONE = ~0u;
+
+    Heap() {}
+    ~Heap() {
+        delete [] nodes;
+        delete [] index;
+    }
+
+    void Reserve(unsigned n) {
+        if (n <= nids)
+            return;
+
+        unsigned *i_ = new unsigned[n];
+        for (unsigned i = 0; i < n; i ++)
+            i_[i] = i < nids ? index[i] : NONE;
+        delete [] index;
+        index = i_;
+        nids = n;
+    }
+
+    void Push(unsigned id, const K &key) {
+        assert(id < nids);
+        assert(index[id] == NONE);
+        if (size == capacity)
+            _grow();
+        nodes[size] = {key, id};
+        index[id] = size;
+        _siftUp(size ++);
+    }
+
+    void Update(unsigned id, const K &key) {
+        assert(Contains(id));
+        unsigned at = index[id];
+        K old = nodes[at].key;
+        nodes[at].key = key;
+        (key < old) ? _siftUp(at) : _siftDown(at);
+    }
+
+    unsigned Pop() {
+        assert(size);
+        unsigned id = nodes[0].id;
+        index[id] = NONE;
+        if (-- size) {
+            nodes[0] = nodes[size];
+            index[nodes[0].id] = 0;
+            _siftDown(0);
+        }
+        return id;
+    }
+
+    void Remove(unsigned id) {
+        assert(Contains(id));
+        unsigned at = index[id];
+        index[id] = NONE;
+        if (at == -- size)
+            return;
+        K old = nodes[at].key;
+        nodes[at] = nodes[size];
+        index[nodes[at].id] = at;
+        (nodes[at].key < old) ? _siftUp(at) : _siftDown(at);
+    }
+
+    unsigned Top() {
+        assert(size);
+        return nodes[0].id;
+    }
+
+    const K &TopKey() {
+        assert(size);
+        return nodes[0].key;
+    }
+
+    const K &Key(unsigned id) {
+        assert(Contains(id));
+        return nodes[index[id]].key;
+    }
+
+    bool Contains(unsigned id) {
+        return id < nids && index[id] != NONE;
+    }
+
+    bool IsEmpty() {
+        return size == 0;
+    }
+
+    unsigned Size() {
+        return size;
+    }
+
+    void Clear() {
+        for (unsigned i = 0; i < size; i ++)
+            index[nodes[i].id] = NONE;
+        size = 0;
+    }
+
+private:
+    struct Node {
+        K key;
+        unsigned id;
+    };
+
+    Node *nodes = nullptr;
+    unsigned size = 0;
+    unsigned capacity = 0;
+
+    unsigned *index = nullptr;
+    unsigned nids = 0;
+
+    void _grow() {
+        capacity = capacity ? capacity * 2 : 64;
+        Node *n = new Node[capacity];
+        for (unsigned i = 0; i < size; i ++)
+            n[i] = nodes[i];
+        delete [] nodes;
+        nodes = n;
+    }
+
+    void _siftUp(unsigned at) {
+        Node n = nodes[at];
+        while (at > 0) {
+            unsigned parent = (at - 1) / D;
+            if (!(n.key < nodes[parent].key))
+                break;
+            nodes[at] = nodes[parent];
+            index[nodes[at].id] = at;
+            at = parent;
+        }
+        nodes[at] = n;
+        index[n.id] = at;
+    }
+
+    void _siftDown(unsigned at) {
+        Node n = nodes[at];
+        for (;;) {
+            unsigned first = at * D + 1;
+            if (first >= size)
+                break;
+
+            unsigned last = first + D < size ? first + D : size;
+            unsigned best = first;
+            for (unsigned c = first + 1; c < last; c ++)
+                if (nodes[c].key < nodes[best].key)
+                    best = c;
+
+            if (!(nodes[best].key < n.key))
+                break;
+            nodes[at] = nodes[best];
+            index[nodes[at].id] = at;
+            at = best;
+        }
+        nodes[at] = n;
+        index[n.id] = at;
+    }
+};
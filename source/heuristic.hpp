@@ -0,0 +1,21 @@
+#pragma once
+
+#include <math.h>
+#include <stdlib.h>
+
+namespace Heuristics {
+    typedef float (*Func)(int x0, int y0, int x1, int y1);
+
+    inline float None(int x0, int y0, int x1, int y1) {
+        (void)x0, (void)y0, (void)x1, (void)y1;
+        return 0;
+    }
+
+    inline float Manhattan(int x0, int y0, int x1, int y1) {
+        return abs(x1 - x0) + abs(y1 - y0);
+    }
+
+    inline float Euclidean(int x0, int y0, int x1, int y1) {
+        return sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+    }
+}
@@ -0,0 +1,443 @@
+#include "hpastar.hpp"
+#include "buckets.hpp"
+#include "maze.hpp"
+
+#include <chrono>
+#include <string.h>
+
+static const uint16_t FAR = 0xffff;
+
+HPAStar::~HPAStar()
+{
+    for (unsigned c = 0; m_clusters && c < m_cw * m_ch; c ++) {
+        delete [] m_clusters[c].cells;
+        delete [] m_clusters[c].dist;
+    }
+    delete [] m_clusters;
+    delete [] m_first;
+    delete [] m_owner;
+    delete [] m_sdist;
+    delete [] m_edist;
+    delete [] m_bfs;
+    delete [] m_queue;
+}
+
+void HPAStar::_resize()
+{
+    for (unsigned c = 0; m_clusters && c < m_cw * m_ch; c ++) {
+        delete [] m_clusters[c].cells;
+        delete [] m_clusters[c].dist;
+    }
+    delete [] m_clusters;
+    delete [] m_first;
+
+    m_cw = (m_width  + SIZE - 1) / SIZE;
+    m_ch = (m_height + SIZE - 1) / SIZE;
+    clusters = m_cw * m_ch;
+    m_clusters = new Cluster[clusters];
+    m_first = new unsigned[clusters + 1];
+
+    if (!m_bfs) {
+        m_bfs   = new uint16_t[SIZE * SIZE];
+        m_queue = new unsigned[SIZE * SIZE];
+        m_sdist = new uint16_t[4 * SIZE];
+        m_edist = new uint16_t[4 * SIZE];
+    }
+}
+
+void HPAStar::Init(Maze *maze, Heuristics::Func h)
+{
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+
+    if (maze->id != log.maze || maze->hcells != m_width || maze->vcells != m_height) {
+        m_maze = maze;
+        m_width = maze->hcells;
+        m_height = maze->vcells;
+        _resize();
+    } else if (!log.InStep(maze)) {
+        for (unsigned c = 0; c < clusters; c ++)
+            m_clusters[c].dirty = true;
+    } else {
+        // a cell on the edge of its cluster also changes the entrances of
+        // the border it is on, and so the cluster across
+        auto dirty = [this](int x, int y) {
+            if (m_maze->PointInBounds(x, y))
+                m_clusters[_cluster(y * m_width + x)].dirty = true;
+        };
+        while (!log.cells.IsEmpty()) {
+            unsigned cell = log.cells.Pop();
+            int x = cell % m_width, y = cell / m_width;
+            dirty(x, y);
+            if (x % SIZE == 0)        dirty(x - 1, y);
+            if (x % SIZE == SIZE - 1) dirty(x + 1, y);
+            if (y % SIZE == 0)        dirty(x, y - 1);
+            if (y % SIZE == SIZE - 1) dirty(x, y + 1);
+        }
+    }
+    log.Sync(maze);
+    m_h = h;
+
+    rebuilt = 0;
+    for (unsigned c = 0; c < clusters; c ++) {
+        if (m_clusters[c].dirty) {
+            _build(c);
+            rebuilt ++;
+        }
+    }
+
+    if (rebuilt) {
+        edges = 0;
+        m_first[0] = 0;
+        for (unsigned c = 0; c < clusters; c ++) {
+            m_first[c + 1] = m_first[c] + m_clusters[c].n;
+            edges += m_clusters[c].edges;
+        }
+        nodes = m_first[clusters];
+        edges /= 2;
+
+        if (nodes > m_capacity) {
+            delete [] m_owner;
+            m_capacity = nodes;
+            m_owner = new unsigned[m_capacity];
+        }
+        for (unsigned c = 0; c < clusters; c ++)
+            for (unsigned i = m_first[c]; i < m_first[c + 1]; i ++)
+                m_owner[i] = c;
+    }
+    auto t1 = clock::now();
+    std::chrono::duration<float, std::milli> d = t1 - t0;
+    buildMs = d.count();
+    queryMs = m_searchMs = 0;
+
+    // the start and the end join the graph through their clusters
+    m_source = nodes;
+    m_goal = nodes + 1;
+    m_s = maze->start.y * m_width + maze->start.x;
+    m_e = maze->end  .y * m_width + maze->end  .x;
+    m_sc = _cluster(m_s);
+    m_ec = _cluster(m_e);
+    m_direct = INF;
+    searched = 0;
+    m_search.Begin(maze, h, nodes + 2);
+    m_done = !maze->IsOpen(maze->start.x, maze->start.y) || !maze->IsOpen(maze->end.x, maze->end.y);
+    if (m_done)
+        return;
+
+    searched += _bfs(m_sc, m_s);
+    for (unsigned i = 0; i < m_clusters[m_sc].n; i ++)
+        m_sdist[i] = _at(m_clusters[m_sc].cells[i]);
+    if (m_sc == m_ec && _at(m_e) != FAR)
+        m_direct = _at(m_e);
+
+    searched += _bfs(m_ec, m_e);
+    for (unsigned i = 0; i < m_clusters[m_ec].n; i ++)
+        m_edist[i] = _at(m_clusters[m_ec].cells[i]);
+
+    _relax(m_source, m_source, 0);
+    d = clock::now() - t1;
+    queryMs = m_searchMs = d.count();
+}
+
+unsigned HPAStar::_cluster(unsigned cell)
+{
+    unsigned x = cell % m_width, y = cell / m_width;
+    return y / SIZE * m_cw + x / SIZE;
+}
+
+void HPAStar::_bounds(unsigned c, unsigned &x0, unsigned &y0, unsigned &x1, unsigned &y1)
+{
+    x0 = c % m_cw * SIZE;
+    y0 = c / m_cw * SIZE;
+    x1 = x0 + SIZE < m_width  ? x0 + SIZE - 1 : m_width  - 1;
+    y1 = y0 + SIZE < m_height ? y0 + SIZE - 1 : m_height - 1;
+}
+
+unsigned HPAStar::_cell(unsigned id)
+{
+    if (id == m_source) return m_s;
+    if (id == m_goal)   return m_e;
+    unsigned c = m_owner[id];
+    return m_clusters[c].cells[id - m_first[c]];
+}
+
+unsigned HPAStar::_find(unsigned c, unsigned cell)
+{
+    auto &k = m_clusters[c];
+    for (unsigned i = 0; i < k.n; i ++)
+        if (k.cells[i] == cell)
+            return i;
+    return INF;
+}
+
+////////////////////////////////
+// Clusters
+////////////////////////////////
+
+// The cells of cluster c facing an open cell across one of its borders,
+// the middle one of each run of them. The cluster across picks the same
+// runs from its side. Corner cells may come twice, once per border.
+void HPAStar::_entrances(unsigned c, Stack<unsigned> &out)
+{
+    unsigned x0, y0, x1, y1;
+    _bounds(c, x0, y0, x1, y1);
+    unsigned cx = c % m_cw, cy = c / m_cw;
+
+    auto runs = [this, &out](bool vertical, int at, int across, unsigned lo, unsigned hi) {
+        unsigned first = INF;
+        for (unsigned k = lo; k <= hi + 1; k ++) {
+            bool open = k <= hi && (vertical
+                ? m_maze->IsOpen(at, k) && m_maze->IsOpen(at + across, k)
+                : m_maze->IsOpen(k, at) && m_maze->IsOpen(k, at + across));
+            if (open && first == INF)
+                first = k;
+            if (!open && first != INF) {
+                unsigned m = (first + k - 1) / 2;
+                out.Push(vertical ? m * m_width + at : at * m_width + m);
+                first = INF;
+            }
+        }
+    };
+
+    if (cx > 0)        runs(true , x0, -1, y0, y1);
+    if (cx + 1 < m_cw) runs(true , x1, +1, y0, y1);
+    if (cy > 0)        runs(false, y0, -1, x0, x1);
+    if (cy + 1 < m_ch) runs(false, y1, +1, x0, x1);
+}
+
+void HPAStar::_build(unsigned c)
+{
+    auto &k = m_clusters[c];
+    auto &e = m_entrances;
+    e.Clear();
+    _entrances(c, e);
+
+    unsigned n = 0;
+    for (unsigned i = 0; i < e.Size(); i ++) {
+        unsigned j = 0;
+        while (j < n && e[j] != e[i])
+            j ++;
+        if (j == n)
+            e[n ++] = e[i];
+    }
+
+    delete [] k.cells;
+    delete [] k.dist;
+    k.n = n;
+    k.cells = new unsigned[n];
+    k.dist = new uint16_t[n * n];
+    k.edges = e.Size();
+    for (unsigned i = 0; i < n; i ++)
+        k.cells[i] = e[i];
+
+    for (unsigned i = 0; i < n; i ++) {
+        _bfs(c, k.cells[i]);
+        for (unsigned j = 0; j < n; j ++) {
+            k.dist[i * n + j] = _at(k.cells[j]);
+            k.edges += j != i && k.dist[i * n + j] != FAR;
+        }
+    }
+    k.dirty = false;
+}
+
+// Distances from cell from to every cell of cluster c, through the
+// cluster alone, into m_bfs. Returns the number of cells reached.
+unsigned HPAStar::_bfs(unsigned c, unsigned from)
+{
+    unsigned x0, y0, x1, y1;
+    _bounds(c, x0, y0, x1, y1);
+    unsigned w = x1 - x0 + 1, h = y1 - y0 + 1;
+    m_box = {x0, y0, w, h};
+    memset(m_bfs, 0xff, w * h * sizeof(*m_bfs));
+
+    unsigned head = 0, tail = 0;
+    unsigned at = (from / m_width - y0) * w + from % m_width - x0;
+    m_bfs[at] = 0;
+    m_queue[tail ++] = at;
+    while (head < tail) {
+        unsigned i = m_queue[head ++];
+        unsigned lx = i % w, ly = i / w;
+        uint16_t d = m_bfs[i] + 1;
+        auto visit = [&](unsigned lx, unsigned ly) {
+            unsigned j = ly * w + lx;
+            if (m_bfs[j] != FAR || m_maze->IsWall(x0 + lx, y0 + ly))
+                return;
+            m_bfs[j] = d;
+            m_queue[tail ++] = j;
+        };
+        if (lx > 0)     visit(lx - 1, ly);
+        if (lx + 1 < w) visit(lx + 1, ly);
+        if (ly > 0)     visit(lx, ly - 1);
+        if (ly + 1 < h) visit(lx, ly + 1);
+    }
+    return tail;
+}
+
+bool HPAStar::_inBox(int x, int y)
+{
+    return x >= (int)m_box.x0 && y >= (int)m_box.y0
+        && x < (int)(m_box.x0 + m_box.w) && y < (int)(m_box.y0 + m_box.h);
+}
+
+uint16_t HPAStar::_at(unsigned cell)
+{
+    unsigned x = cell % m_width - m_box.x0, y = cell / m_width - m_box.y0;
+    return m_bfs[y * m_box.w + x];
+}
+
+////////////////////////////////
+// Query
+////////////////////////////////
+
+void HPAStar::_relax(unsigned id, unsigned from, unsigned cost)
+{
+    m_search.Relax(id, _cell(id), from, cost);
+}
+
+bool HPAStar::Step()
+{
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    bool more = _step();
+    std::chrono::duration<float, std::milli> d = clock::now() - t0;
+    queryMs = m_searchMs += d.count();
+    return more;
+}
+
+bool HPAStar::_step()
+{
+    if (m_done)
+        return false;
+    unsigned u = m_search.Pop(m_goal);
+    if (u == INF) {
+        m_done = true;
+        return false;
+    }
+
+    unsigned cell = _cell(u);
+    x = cell % m_width, y = cell / m_width;
+    (*m_maze)(x, y) = DEAD;
+    searched ++;
+
+    unsigned g = m_search.G(u);
+    if (u == m_source) {
+        for (unsigned i = 0; i < m_clusters[m_sc].n; i ++)
+            if (m_sdist[i] != FAR)
+                _relax(m_first[m_sc] + i, u, g + m_sdist[i]);
+        if (m_direct != INF)
+            _relax(m_goal, u, g + m_direct);
+        return true;
+    }
+
+    unsigned c = m_owner[u], i = u - m_first[c];
+    auto &k = m_clusters[c];
+    for (unsigned j = 0; j < k.n; j ++)
+        if (j != i && k.dist[i * k.n + j] != FAR)
+            _relax(m_first[c] + j, u, g + k.dist[i * k.n + j]);
+    if (c == m_ec && m_edist[i] != FAR)
+        _relax(m_goal, u, g + m_edist[i]);
+
+    // steps onto the nodes across the borders
+    auto across = [this, c, u, g](int x, int y) {
+        if (!m_maze->IsOpen(x, y))
+            return;
+        unsigned to = y * m_width + x, nc = _cluster(to);
+        unsigned j = nc != c ? _find(nc, to) : INF;
+        if (j != INF)
+            _relax(m_first[nc] + j, u, g + 1);
+    };
+    across(x - 1, y);
+    across(x + 1, y);
+    across(x, y - 1);
+    across(x, y + 1);
+    return true;
+}
+
+unsigned HPAStar::Trace(CellState t, unsigned &cost)
+{
+    if (!Found())
+        return 0;
+
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    unsigned n = 0;
+    (*m_maze)(m_e % m_width, m_e / m_width) = t;
+    cost += m_maze->Weight(m_e % m_width, m_e / m_width);
+    for (unsigned v = m_goal; v != m_source; v = m_search.Parent(v)) {
+        unsigned u = m_search.Parent(v);
+        unsigned a = _cell(u), b = _cell(v);
+        if (u != m_source && v != m_goal && m_owner[u] != m_owner[v]) {
+            (*m_maze)(a % m_width, a / m_width) = t;
+            cost += m_maze->Weight(a % m_width, a / m_width);
+            n ++;
+            continue;
+        }
+
+        // back from b down the distances from a, within their cluster
+        searched += _bfs(u == m_source ? m_sc : m_owner[u], a);
+        int x = b % m_width, y = b / m_width;
+        for (unsigned d = _at(b); d > 0; d --) {
+            int nx[4] = {x - 1, x + 1, x, x};
+            int ny[4] = {y, y, y - 1, y + 1};
+            for (unsigned k = 0; k < 4; k ++) {
+                if (_inBox(nx[k], ny[k]) && _at(ny[k] * m_width + nx[k]) == d - 1) {
+                    x = nx[k], y = ny[k];
+                    break;
+                }
+            }
+            (*m_maze)(x, y) = t;
+            cost += m_maze->Weight(x, y);
+            n ++;
+        }
+    }
+    std::chrono::duration<float, std::milli> d = clock::now() - t0;
+    queryMs = m_searchMs + d.count();
+    return n;
+}
+
+void HPAStar::TimeFlat()
+{
+    if (m_flat.maze == log.maze && m_flat.wallEdits == log.wallEdits && m_flat.s == m_s && m_flat.e == m_e && m_flat.h == m_h)
+        return;
+    m_flat = {log.maze, log.wallEdits, m_s, m_e, m_h};
+
+    size_t n = (size_t)m_width * m_height;
+    unsigned *g = new unsigned[n];
+    memset(g, 0xff, n * sizeof(*g));
+    Buckets<unsigned> open;
+    int ex = m_e % m_width, ey = m_e / m_width;
+    auto f = [&](unsigned i) {
+        return g[i] + (unsigned)m_h(i % m_width, i / m_width, ex, ey);
+    };
+
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+    if (m_maze->IsOpen(m_s % m_width, m_s / m_width) && m_maze->IsOpen(ex, ey)) {
+        g[m_s] = 0;
+        open.Push(f(m_s), m_s);
+    }
+    while (!open.IsEmpty()) {
+        unsigned key, i = open.Pop(key);
+        if (i == m_e)
+            break;
+        // left behind when the cell was queued again at a lower g
+        if (key != f(i))
+            continue;
+
+        int x = i % m_width, y = i / m_width;
+        int nx[4] = {x - 1, x + 1, x, x};
+        int ny[4] = {y, y, y - 1, y + 1};
+        for (unsigned k = 0; k < 4; k ++) {
+            if (!m_maze->IsOpen(nx[k], ny[k]))
+                continue;
+            unsigned j = ny[k] * m_width + nx[k];
+            if (g[j] <= g[i] + 1)
+                continue;
+            g[j] = g[i] + 1;
+            open.Push(f(j), j);
+        }
+    }
+    std::chrono::duration<float, std::milli> d = clock::now() - t0;
+    flatMs = d.count();
+    delete [] g;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include "maze.hpp"
+#include "stack.hpp"
+#include "nodesearch.hpp"
+
+// Hierarchical A*. The maze is cut into square clusters. Where a run of
+// open cells faces another across a cluster border, the middle pair
+// becomes an entrance, a node in both clusters joined by a step. Within
+// a cluster every pair of nodes is joined by their distance through the
+// cluster alone.
+//
+// A query links the start and the end to the nodes of their clusters,
+// runs A* over that graph and then walks the path it found cell by cell,
+// one cluster at a time. Paths are close to, but not always, shortest.
+//
+// The graph outlives a query. Only clusters holding a logged cell are
+// rebuilt, along with the neighbours sharing a border the cell is on. A
+// wall change that was not logged rebuilds them all.
+class HPAStar {
+public:
+    static constexpr unsigned SIZE = 16; // cluster side, in cells
+    static constexpr unsigned INF = ~0u;
+
+     HPAStar() {}
+    ~HPAStar();
+
+    // Rebuilds the clusters that changed, then starts a query from the
+    // start of the maze to its end.
+    void Init(Maze *maze, Heuristics::Func h);
+
+    // Expands one node of the graph, returns false once the query is done.
+    bool Step();
+    bool Found() { return m_done && m_search.G(m_goal) != INF; }
+    // Writes t along the path cell by cell and returns its length, 0
+    // until the query is done. Adds the weights of its cells to cost.
+    unsigned Trace(CellState t, unsigned &cost);
+    // Times plain A* over the cells for the query of the last Init, into
+    // flatMs. Runs again only once the walls, the start, the end or the
+    // heuristic changed.
+    void TimeFlat();
+
+    int x = 0, y = 0; // cell of the last node expanded
+
+    // the graph, as of the last Init
+    unsigned clusters = 0;
+    unsigned rebuilt = 0; // by the last Init
+    unsigned nodes = 0;
+    unsigned edges = 0;
+    float buildMs = 0;    // taken rebuilding them
+
+    unsigned searched = 0; // nodes and cells the query visited so far
+    float queryMs = 0;     // taken by the query so far, the refining included
+    float flatMs = 0;      // taken by plain A* on the same query, see TimeFlat
+
+    WallLog log; // walls written since the last Init
+
+private:
+    struct Cluster {
+        unsigned n = 0;
+        unsigned *cells = nullptr; // of the nodes
+        uint16_t *dist = nullptr;  // n by n, 0xffff when apart
+        unsigned edges = 0;        // finite entries of dist, and steps out
+        bool dirty = true;
+    };
+
+    Maze *m_maze = nullptr;
+    Heuristics::Func m_h = nullptr;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    unsigned m_cw = 0; // clusters per row
+    unsigned m_ch = 0; // clusters per column
+
+    Cluster *m_clusters = nullptr;
+    Stack<unsigned> m_entrances; // scratch of _build
+
+    // nodes are numbered cluster after cluster, the start and the end of
+    // a query come last
+    unsigned *m_first = nullptr; // per cluster, plus one past the last
+    unsigned *m_owner = nullptr; // per node
+    unsigned m_capacity = 0;     // of m_owner
+    unsigned m_source = 0;
+    unsigned m_goal = 0;
+    unsigned m_sc = 0, m_ec = 0; // clusters of the start and the end
+    unsigned m_s = 0, m_e = 0;   // cells of the start and the end
+    uint16_t *m_sdist = nullptr; // start to the nodes of its cluster
+    uint16_t *m_edist = nullptr; // end to the nodes of its cluster
+    unsigned m_direct = INF;     // start to end within one cluster
+
+    NodeSearch m_search;
+    bool m_done = true;
+    float m_searchMs = 0; // queryMs up to the last Step
+
+    // query TimeFlat last timed
+    struct { unsigned long long maze; unsigned long long wallEdits; unsigned s, e; Heuristics::Func h; } m_flat = {};
+
+    // scratch of one cluster's breadth first search, over the box of it
+    uint16_t *m_bfs = nullptr;
+    unsigned *m_queue = nullptr;
+    struct { unsigned x0, y0, w, h; } m_box = {};
+
+    unsigned _cluster(unsigned cell);
+    void _bounds(unsigned c, unsigned &x0, unsigned &y0, unsigned &x1, unsigned &y1);
+    void _entrances(unsigned c, Stack<unsigned> &out);
+    void _build(unsigned c);
+    unsigned _bfs(unsigned c, unsigned from);
+    bool _inBox(int x, int y);
+    uint16_t _at(unsigned cell);
+    unsigned _find(unsigned c, unsigned cell);
+    unsigned _cell(unsigned id);
+    void _relax(unsigned id, unsigned from, unsigned cost);
+    bool _step();
+    void _resize();
+};
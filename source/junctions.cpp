@@ -0,0 +1,260 @@
+#include "junctions.hpp"
+
+#include <string.h>
+
+static const int DX[4] = {-1, 1, 0, 0};
+static const int DY[4] = {0, 0, -1, 1};
+
+JunctionGraph::~JunctionGraph()
+{
+    delete [] m_node;
+}
+
+bool JunctionGraph::_isNode(unsigned cell)
+{
+    int x = cell % m_width, y = cell / m_width;
+    if (!m_maze->IsOpen(x, y))
+        return false;
+    if (cell == m_start || cell == m_end)
+        return true;
+    unsigned n = 0;
+    for (unsigned d = 0; d < 4; d ++)
+        n += m_maze->IsOpen(x + DX[d], y + DY[d]);
+    return n != 2;
+}
+
+// The cell next to cell in direction d, NONE when closed.
+unsigned JunctionGraph::_step(unsigned cell, unsigned d)
+{
+    int x = cell % m_width + DX[d], y = cell / m_width + DY[d];
+    return m_maze->IsOpen(x, y) ? y * m_width + x : NONE;
+}
+
+// Follows the corridor leaving cell in direction d up to the next node,
+// writing t over the cells on the way when given and adding their weights
+// to cost. Returns that node's
+// cell, its distance and the direction leading back, or NONE when the
+// way is closed or the corridor loops back without meeting a node.
+unsigned JunctionGraph::_walk(unsigned cell, unsigned d, unsigned &len, unsigned &back, const CellState *t, unsigned *cost)
+{
+    unsigned at = _step(cell, d);
+    len = 1;
+    while (at != NONE && !_isNode(at)) {
+        if (at == cell)
+            return NONE;
+        if (t)
+            (*m_maze)(at % m_width, at / m_width) = *t;
+        if (cost)
+            *cost += m_maze->Weight(at % m_width, at / m_width);
+        // a corridor cell has one way on besides the one it was entered by
+        unsigned in = d ^ 1;
+        for (d = 0; d < 4 && (d == in || _step(at, d) == NONE); d ++);
+        at = _step(at, d);
+        len ++;
+    }
+    back = d ^ 1;
+    return at;
+}
+
+unsigned JunctionGraph::_add(unsigned cell)
+{
+    Node n = {cell, {{NONE, 0}, {NONE, 0}, {NONE, 0}, {NONE, 0}}};
+    unsigned id;
+    if (!m_free.IsEmpty()) {
+        id = m_free.Pop();
+        m_nodes[id] = n;
+    } else {
+        id = m_nodes.Size();
+        m_nodes.Push(n);
+    }
+    m_node[cell] = id;
+    nodes ++;
+    return id;
+}
+
+// Walks every corridor of node id again, and sets the far end of each to
+// lead back.
+void JunctionGraph::_link(unsigned id)
+{
+    unsigned cell = m_nodes[id].cell;
+    if (m_node[cell] != id)
+        return;
+    for (unsigned d = 0; d < 4; d ++) {
+        unsigned len, back;
+        unsigned end = _walk(cell, d, len, back, nullptr);
+        if (end == NONE) {
+            m_nodes[id].edges[d] = {NONE, 0};
+            continue;
+        }
+        unsigned to = m_node[end];
+        m_nodes[id].edges[d] = {to, len};
+        m_nodes[to].edges[back] = {id, len};
+    }
+    relinked ++;
+}
+
+void JunctionGraph::_build()
+{
+    size_t n = (size_t)m_width * m_height;
+    delete [] m_node;
+    m_node = new unsigned[n];
+    memset(m_node, 0xff, n * sizeof(*m_node));
+    m_nodes.Clear();
+    m_free.Clear();
+    nodes = 0;
+
+    for (unsigned cell = 0; cell < n; cell ++)
+        if (_isNode(cell))
+            _add(cell);
+    for (unsigned id = 0; id < m_nodes.Size(); id ++)
+        _link(id);
+}
+
+// Redoes the nodes of cell and its neighbours, whose number of open
+// neighbours may have changed.
+void JunctionGraph::_renode(unsigned cell)
+{
+    int x = cell % m_width, y = cell / m_width;
+    int nx[5] = {x, x - 1, x + 1, x, x};
+    int ny[5] = {y, y, y, y - 1, y + 1};
+    for (unsigned k = 0; k < 5; k ++) {
+        if (!m_maze->PointInBounds(nx[k], ny[k]))
+            continue;
+        unsigned c = ny[k] * m_width + nx[k];
+        bool was = m_node[c] != NONE, is = _isNode(c);
+        if (was && !is) {
+            m_free.Push(m_node[c]);
+            m_node[c] = NONE;
+            nodes --;
+        } else if (!was && is) {
+            _add(c);
+        }
+    }
+}
+
+// Queues the nodes of cell and its neighbours for relinking, along with
+// the nodes at the far ends of the corridors passing through them.
+void JunctionGraph::_unlink(unsigned cell)
+{
+    int x = cell % m_width, y = cell / m_width;
+    int nx[5] = {x, x - 1, x + 1, x, x};
+    int ny[5] = {y, y, y, y - 1, y + 1};
+    for (unsigned k = 0; k < 5; k ++) {
+        if (!m_maze->IsOpen(nx[k], ny[k]))
+            continue;
+        unsigned c = ny[k] * m_width + nx[k];
+        if (m_node[c] != NONE)
+            m_dirty.Push(m_node[c]);
+        for (unsigned d = 0; d < 4; d ++) {
+            unsigned len, back;
+            unsigned end = _walk(c, d, len, back, nullptr);
+            if (end != NONE)
+                m_dirty.Push(m_node[end]);
+        }
+    }
+}
+
+// Every node must be settled before any corridor is walked, a walk
+// stops at the first cell that is a node.
+void JunctionGraph::_update()
+{
+    auto &changed = log.cells;
+    for (unsigned i = 0; i < changed.Size(); i ++)
+        _renode(changed[i]);
+    m_dirty.Clear();
+    for (unsigned i = 0; i < changed.Size(); i ++)
+        _unlink(changed[i]);
+    for (unsigned i = 0; i < m_dirty.Size(); i ++)
+        _link(m_dirty[i]);
+}
+
+void JunctionGraph::Init(Maze *maze, Heuristics::Func h)
+{
+    unsigned start = maze->start.y * maze->hcells + maze->start.x;
+    unsigned end   = maze->end  .y * maze->hcells + maze->end  .x;
+    relinked = 0;
+    if (!log.InStep(maze) || maze->hcells != m_width || maze->vcells != m_height) {
+        m_maze = maze;
+        m_width = maze->hcells;
+        m_height = maze->vcells;
+        m_start = start;
+        m_end = end;
+        _build();
+    } else {
+        // the start and the end are nodes wherever they are
+        if (start != m_start || end != m_end) {
+            log.cells.Push(m_start);
+            log.cells.Push(m_end);
+            log.cells.Push(start);
+            log.cells.Push(end);
+            m_start = start;
+            m_end = end;
+        }
+        _update();
+    }
+    log.Sync(maze);
+
+    m_search.Begin(maze, h, m_nodes.Size());
+    m_source = m_node[start];
+    m_goal = m_node[end];
+    m_done = m_source == NONE || m_goal == NONE;
+    if (!m_done)
+        m_search.Relax(m_source, start, m_source, 0);
+}
+
+bool JunctionGraph::Step()
+{
+    if (m_done)
+        return false;
+    unsigned u = m_search.Pop(m_goal);
+    if (u == NONE) {
+        m_done = true;
+        return false;
+    }
+
+    unsigned cell = m_nodes[u].cell;
+    x = cell % m_width, y = cell / m_width;
+    (*m_maze)(x, y) = DEAD;
+
+    for (unsigned d = 0; d < 4; d ++) {
+        Edge e = m_nodes[u].edges[d];
+        if (e.to != NONE)
+            m_search.Relax(e.to, m_nodes[e.to].cell, u, m_search.G(u) + e.len);
+    }
+    return true;
+}
+
+bool JunctionGraph::Found()
+{
+    return m_done && m_goal != NONE && m_search.G(m_goal) != NONE;
+}
+
+unsigned JunctionGraph::Trace(int x, int y, CellState t, unsigned &cost)
+{
+    if (!m_maze->PointInBounds(x, y))
+        return 0;
+    unsigned id = m_node[y * m_width + x];
+    if (id == NONE || m_search.G(id) == NONE)
+        return 0;
+
+    unsigned n = 0;
+    (*m_maze)(x, y) = t;
+    cost += m_maze->Weight(x, y);
+    while (id != m_source) {
+        // of the corridors joining the parent to id, relaxing kept the
+        // shortest
+        unsigned p = m_search.Parent(id), via = 0, len, back;
+        for (unsigned d = 1; d < 4; d ++) {
+            Edge e = m_nodes[p].edges[d], v = m_nodes[p].edges[via];
+            if (e.to == id && (v.to != id || e.len < v.len))
+                via = d;
+        }
+        _walk(m_nodes[p].cell, via, len, back, &t, &cost);
+        unsigned cell = m_nodes[p].cell;
+        (*m_maze)(cell % m_width, cell / m_width) = t;
+        cost += m_maze->Weight(cell % m_width, cell / m_width);
+        n += len;
+        id = p;
+    }
+    return n;
+}
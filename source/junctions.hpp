@@ -0,0 +1,75 @@
+#pragma once
+
+#include "maze.hpp"
+#include "stack.hpp"
+#include "nodesearch.hpp"
+
+// The maze contracted to its junctions, dead ends, start and end. Every
+// other open cell has exactly two open neighbours and lies on a corridor
+// joining two nodes. A node keeps, per direction, the node the corridor
+// leaving that way leads to and its length. The cells of a corridor are
+// not stored, it is walked again from either end when needed.
+//
+// A search runs A* over the nodes and walks the corridors of its path to
+// write it cell by cell. The graph outlives the search. A logged cell only
+// relinks the nodes whose corridors pass next to it. A wall change that
+// was not logged rebuilds the whole graph.
+class JunctionGraph {
+public:
+    static constexpr unsigned NONE = ~0u;
+
+     JunctionGraph() {}
+    ~JunctionGraph();
+
+    // Brings the graph up to date with the maze, then starts a search from
+    // its start to its end.
+    void Init(Maze *maze, Heuristics::Func h);
+
+    // Expands one node, returns false once the search is done.
+    bool Step();
+    bool Found();
+    // Writes t along the best known path from node cell (x, y) back to
+    // the start and returns its length. Adds the weights of its cells to
+    // cost.
+    unsigned Trace(int x, int y, CellState t, unsigned &cost);
+
+    int x = 0, y = 0; // cell of the last node expanded
+
+    unsigned nodes = 0;   // in the graph
+    unsigned relinked = 0; // nodes the last Init walked the corridors of
+
+    WallLog log; // walls written since the last Init
+
+private:
+    struct Edge { unsigned to, len; };
+    struct Node {
+        unsigned cell;
+        Edge edges[4]; // L, R, T, B, to NONE when closed
+    };
+
+    Maze *m_maze = nullptr;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    unsigned m_start = NONE;
+    unsigned m_end = NONE;
+
+    unsigned *m_node = nullptr; // per cell, its node or NONE
+    Stack<Node> m_nodes;
+    Stack<unsigned> m_free;     // ids of removed nodes
+    Stack<unsigned> m_dirty;    // nodes to relink
+
+    NodeSearch m_search;
+    unsigned m_source = NONE;
+    unsigned m_goal = NONE;
+    bool m_done = true;
+
+    bool _isNode(unsigned cell);
+    unsigned _step(unsigned cell, unsigned d);
+    unsigned _walk(unsigned cell, unsigned d, unsigned &len, unsigned &back, const CellState *t, unsigned *cost = nullptr);
+    unsigned _add(unsigned cell);
+    void _link(unsigned id);
+    void _build();
+    void _renode(unsigned cell);
+    void _unlink(unsigned cell);
+    void _update();
+};
@@ -0,0 +1,172 @@
+#include "lpastar.hpp"
+#include "maze.hpp"
+
+#include <math.h>
+#include <string.h>
+
+LPAStar::~LPAStar()
+{
+    delete [] m_g;
+    delete [] m_rhs;
+}
+
+bool LPAStar::Init(Maze *maze, Heuristics::Func h)
+{
+    unsigned start = maze->start.y * maze->hcells + maze->start.x;
+    unsigned end   = maze->end  .y * maze->hcells + maze->end  .x;
+    bool keep = log.InStep(maze) && m_h == h
+        && m_width == maze->hcells && m_height == maze->vcells
+        && m_start == start && m_end == end;
+
+    if (!keep) {
+        if (m_width != maze->hcells || m_height != maze->vcells) {
+            delete [] m_g;
+            delete [] m_rhs;
+            m_g = m_rhs = nullptr;
+        }
+        m_maze = maze;
+        m_h = h;
+        m_width = maze->hcells;
+        m_height = maze->vcells;
+        m_start = start;
+        m_end = end;
+        log.Sync(maze);
+        _reset();
+        return false;
+    }
+
+    while (!log.cells.IsEmpty())
+        _updateAround(log.cells.Pop());
+    return true;
+}
+
+void LPAStar::_reset()
+{
+    size_t n = (size_t)m_width * m_height;
+    if (!m_g) {
+        m_g   = new unsigned[n];
+        m_rhs = new unsigned[n];
+    }
+    memset(m_g  , 0xff, n * sizeof(*m_g));
+    memset(m_rhs, 0xff, n * sizeof(*m_rhs));
+    m_open.Clear();
+    m_open.Reserve(n);
+    _update(m_start);
+}
+
+LPAStar::Key LPAStar::_key(unsigned i)
+{
+    unsigned g = m_g[i] < m_rhs[i] ? m_g[i] : m_rhs[i];
+    if (g == INF)
+        return {INFINITY, INF};
+    int x = i % m_width, y = i / m_width;
+    return {g + m_h(x, y, m_maze->end.x, m_maze->end.y), g};
+}
+
+// Recomputes rhs of cell i from its neighbours and queues it, or takes it
+// off the queue, by whether it now agrees with g.
+void LPAStar::_update(unsigned i)
+{
+    int x = i % m_width, y = i / m_width;
+    unsigned rhs = INF;
+    if (i == m_start) {
+        rhs = m_maze->IsOpen(x, y) ? 0 : INF;
+    } else if (m_maze->IsOpen(x, y)) {
+        auto from = [this, &rhs](int x, int y) {
+            if (!m_maze->IsOpen(x, y))
+                return;
+            unsigned g = m_g[y * m_width + x];
+            if (g != INF && g + 1 < rhs)
+                rhs = g + 1;
+        };
+        from(x - 1, y);
+        from(x + 1, y);
+        from(x, y - 1);
+        from(x, y + 1);
+    }
+    m_rhs[i] = rhs;
+
+    bool queued = m_open.Contains(i);
+    if (m_g[i] == rhs) {
+        if (queued)
+            m_open.Remove(i);
+    } else if (queued) {
+        m_open.Update(i, _key(i));
+    } else {
+        m_open.Push(i, _key(i));
+        if (m_maze->IsOpen(x, y))
+            (*m_maze)(x, y) = ACTIVE;
+    }
+}
+
+void LPAStar::_updateAround(unsigned i)
+{
+    int x = i % m_width, y = i / m_width;
+    _update(i);
+    if (x > 0)                      _update(i - 1);
+    if ((unsigned)x + 1 < m_width)  _update(i + 1);
+    if (y > 0)                      _update(i - m_width);
+    if ((unsigned)y + 1 < m_height) _update(i + m_width);
+}
+
+bool LPAStar::Step()
+{
+    if (m_open.IsEmpty())
+        return false;
+    if (!(m_open.TopKey() < _key(m_end)) && m_g[m_end] == m_rhs[m_end])
+        return false;
+
+    unsigned i = m_open.Pop();
+    x = i % m_width, y = i / m_width;
+    if (m_maze->IsOpen(x, y))
+        (*m_maze)(x, y) = DEAD;
+
+    // overconsistent cells settle, underconsistent ones are raised and
+    // queued again if anything still reaches them
+    if (m_g[i] > m_rhs[i]) {
+        m_g[i] = m_rhs[i];
+    } else {
+        m_g[i] = INF;
+        _update(i);
+    }
+    _updateAround(i);
+    return true;
+}
+
+bool LPAStar::Found()
+{
+    return m_g[m_end] != INF && m_g[m_end] == m_rhs[m_end];
+}
+
+unsigned LPAStar::Trace(int x, int y, CellState t, unsigned &cost)
+{
+    unsigned i = y * m_width + x;
+    if (!m_maze->IsOpen(x, y) || m_g[i] == INF)
+        return 0;
+
+    // g only goes down along the way, so the walk ends even mid search
+    unsigned n = 0;
+    (*m_maze)(x, y) = t;
+    cost += m_maze->Weight(x, y);
+    while (i != m_start) {
+        unsigned best = m_g[i], next = i;
+        auto down = [this, &best, &next](int x, int y) {
+            unsigned j = y * m_width + x;
+            if (m_maze->IsOpen(x, y) && m_g[j] < best)
+                best = m_g[j], next = j;
+        };
+        down(x - 1, y);
+        down(x + 1, y);
+        down(x, y - 1);
+        down(x, y + 1);
+        if (next == i)
+            break;
+
+        i = next;
+        x = i % m_width, y = i / m_width;
+        (*m_maze)(x, y) = t;
+        cost += m_maze->Weight(x, y);
+        n ++;
+    }
+    return n;
+}
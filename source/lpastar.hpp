@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include "maze.hpp"
+#include "heap.hpp"
+#include "heuristic.hpp"
+
+// Lifelong Planning A*. Every cell keeps g, its distance from the start
+// as last expanded, and rhs, the distance its neighbours' g imply. Only
+// cells where the two disagree are queued, so once a search is done, a
+// wall change only queues the cells around it and the next search
+// repairs the distances it invalidated instead of starting over.
+//
+// The state outlives a search as long as the maze, start, end and
+// heuristic stay the same and every wall change since was logged. The
+// maze is told apart by Maze::id, another maze at the same address starts
+// over.
+class LPAStar {
+public:
+    static constexpr unsigned INF = ~0u;
+
+     LPAStar() {}
+    ~LPAStar();
+
+    // Repairs the search around the logged cells, or starts it over when
+    // it cannot be carried on. Returns false when it started over.
+    bool Init(Maze *maze, Heuristics::Func h);
+
+    // Expands one cell, returns false once the shortest path to the end is
+    // known, or known not to exist.
+    bool Step();
+    bool Found();
+    // Writes t along the best known path from (x, y) back to the start
+    // and returns its length. Adds the weights of its cells to cost.
+    unsigned Trace(int x, int y, CellState t, unsigned &cost);
+
+    int x = 0, y = 0; // last cell expanded
+
+    WallLog log; // walls written since the last Init
+
+private:
+    struct Key {
+        float f;
+        unsigned g;
+        bool operator<(const Key &k) const {
+            return f < k.f || (f == k.f && g < k.g);
+        }
+    };
+
+    Maze *m_maze = nullptr;
+    Heuristics::Func m_h = nullptr;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    unsigned m_start = 0;
+    unsigned m_end = 0;
+
+    unsigned *m_g = nullptr;
+    unsigned *m_rhs = nullptr;
+    Heap<Key> m_open;
+
+    Key _key(unsigned i);
+    void _update(unsigned i);
+    void _updateAround(unsigned i);
+    void _reset();
+};
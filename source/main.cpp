@@ -1,9 +1,11 @@
 #include "maze.hpp"
-#include "solver.hpp"
-#include "generator.hpp"
+#include "worker.hpp"
+#include "heuristic.hpp"
+#include "headless.hpp"
+#include "renderer.hpp"
 #include "application.hpp"
-#include <chrono>
 #include <cstdio>
+#include <cstring>
 
 class MazeApp : public BaseApplication
 {
@@ -24,14 +26,21 @@ private:
         } state = Idle;
 
         bool placeWalls = true;
+        bool paintTerrain = false;
+        int  terrain   = Maze::MAX_WEIGHT; // cost of the cells painted
         bool animate   = true;
         int  heuristic = 1;
         const char *algo = nullptr;
 
-        float time = 0;
-        int   step = 1;
-        std::chrono::high_resolution_clock clock;
-        std::chrono::high_resolution_clock::time_point then;
+        int rate = 60; // steps per second
+
+        char file[256] = "maze.mgsm";
+        const char *fileStatus = nullptr;
+        MazeInfo info; // of the maze shown, saved along with it
+
+        // Solver::Type of the path shown, -1 when there is none. Moving the
+        // start solves again when it came from the distance field.
+        int solver = -1;
     } m_state;
 
     struct {
@@ -39,29 +48,30 @@ private:
         struct { float x, y; } pan = {0, 0};
     } m_zoompan;
 
-    Generator m_generator;
-    Solver m_solver;
-
     static constexpr unsigned DEF_W = 51;
     static constexpr unsigned DEF_H = 51;
 
     static constexpr unsigned MIN_W = 5;
     static constexpr unsigned MIN_H = 5;
 
-    static constexpr unsigned MAX_W = 511;
-    static constexpr unsigned MAX_H = 511;
+    static constexpr unsigned MAX_W = 32767;
+    static constexpr unsigned MAX_H = 32767;
+
+    static constexpr int MAX_RATE = 50000000;
 
     struct {
         Maze maze = Maze(DEF_W, DEF_H);
-        SDL_Texture *texture = nullptr;
+        TileRenderer tiles;
         unsigned w = DEF_W;
         unsigned h = DEF_H;
     } m_maze;
 
+    // declared after the maze it draws into
+    Worker m_worker{m_maze.maze};
+
     bool OnInit() override
     {
-        m_maze.texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_TARGET, 512, 512);
-        bool ok = m_maze.texture != NULL;
+        bool ok = m_maze.tiles.Init(m_renderer);
 
         auto &style = ImGui::GetStyle();
         style.WindowBorderSize = 0;
@@ -76,6 +86,9 @@ private:
 
     void OnUpdate() override
     {
+        if (m_worker.Receive() && !m_worker.busy)
+            m_state.state = State::Idle;
+
         auto wflags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove;
 
         ImGui::SetNextWindowPos(ImVec2(10, 10));
@@ -99,24 +112,34 @@ private:
 
             ImGui::Checkbox(m_state.placeWalls ? "Place Walls" : "Place Paths",
                     &m_state.placeWalls);
+            ImGui::Checkbox("Paint Terrain", &m_state.paintTerrain);
+            if (m_state.paintTerrain) {
+                snprintf(buf, 32, "Terrain Cost: %d", m_state.terrain);
+                ImGui::SliderInt("##terrain", &m_state.terrain, 1, Maze::MAX_WEIGHT, buf, flags);
+            }
             if (ImGui::Button("Clear", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
-                m_maze.maze.Fill(PATH);
+                m_worker.Edit([](Maze &m) { m.Fill(PATH); });
 
             ImGui::TextUnformatted("Dimensions");
             int w = m_maze.w >> 1;
             int h = m_maze.h >> 1;
 
+            auto dflags = ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic;
+
             snprintf(buf, 32, "Width: %d", m_maze.w);
-            ImGui::SliderInt("##wslider", &w, MIN_W >> 1, MAX_W >> 1, buf, flags);
+            bool resized = ImGui::SliderInt("##wslider", &w, MIN_W >> 1, MAX_W >> 1, buf, dflags);
 
             snprintf(buf, 32, "Height: %d", m_maze.h);
-            ImGui::SliderInt("##hslider", &h, MIN_H >> 1, MAX_H >> 1, buf, flags);
+            resized |= ImGui::SliderInt("##hslider", &h, MIN_H >> 1, MAX_H >> 1, buf, dflags);
 
-            m_maze.w = (w << 1) | 1;
-            m_maze.h = (h << 1) | 1;
+            // only on a change, a loaded maze may have even sides
+            if (resized) {
+                m_maze.w = (w << 1) | 1;
+                m_maze.h = (h << 1) | 1;
+            }
 
-            if (m_maze.w != m_maze.maze.hcells || m_maze.h != m_maze.maze.vcells)
-                m_maze.maze.Resize(m_maze.w, m_maze.h);
+            if (isIdle && (m_maze.w != m_maze.maze.hcells || m_maze.h != m_maze.maze.vcells))
+                m_worker.Edit([this](Maze &m) { m.Resize(m_maze.w, m_maze.h); });
 
             ImGui::PopItemWidth();
             ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x - 16);
@@ -126,45 +149,88 @@ private:
             int sy = m_maze.maze.start.y >> 1;
 
             snprintf(buf, 32, "%d", m_maze.maze.start.x);
-            ImGui::SliderInt("X##start", &sx, 0, m_maze.maze.hcells >> 1, buf, flags);
+            ImGui::SliderInt("X##start", &sx, 0, (m_maze.maze.hcells - 1) >> 1, buf, flags);
 
             snprintf(buf, 32, "%d", m_maze.maze.start.y);
-            ImGui::SliderInt("Y##start", &sy, 0, m_maze.maze.vcells >> 1, buf, flags);
+            ImGui::SliderInt("Y##start", &sy, 0, (m_maze.maze.vcells - 1) >> 1, buf, flags);
 
-            m_maze.maze.start.x = sx << 1;
-            m_maze.maze.start.y = sy << 1;
+            bool moved = isIdle && (sx << 1 != m_maze.maze.start.x || sy << 1 != m_maze.maze.start.y);
+            if (moved)
+                m_worker.Edit([sx, sy](Maze &m) { m.start.x = sx << 1, m.start.y = sy << 1; });
 
             ImGui::TextUnformatted("End");
             int ex = m_maze.maze.end.x >> 1;
             int ey = m_maze.maze.end.y >> 1;
 
             snprintf(buf, 32, "%d", m_maze.maze.end.x);
-            ImGui::SliderInt("X##end", &ex, 0, m_maze.maze.hcells >> 1, buf, flags);
+            ImGui::SliderInt("X##end", &ex, 0, (m_maze.maze.hcells - 1) >> 1, buf, flags);
 
             snprintf(buf, 32, "%d", m_maze.maze.end.y);
-            ImGui::SliderInt("Y##end", &ey, 0, m_maze.maze.vcells >> 1, buf, flags);
+            ImGui::SliderInt("Y##end", &ey, 0, (m_maze.maze.vcells - 1) >> 1, buf, flags);
 
-            m_maze.maze.end.x = ex << 1;
-            m_maze.maze.end.y = ey << 1;
+            if (isIdle && (ex << 1 != m_maze.maze.end.x || ey << 1 != m_maze.maze.end.y))
+                m_worker.Edit([ex, ey](Maze &m) { m.end.x = ex << 1, m.end.y = ey << 1; });
+
+            ImGui::PopItemWidth();
+            ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
+
+            ImGui::TextUnformatted("File");
+            ImGui::InputText("##file", m_state.file, sizeof(m_state.file));
+
+            float half = (ImGui::GetContentRegionAvail().x - ImGui::GetStyle().ItemSpacing.x) / 2;
+            if (ImGui::Button("Save", ImVec2(half, 0))) {
+                bool ok = m_maze.maze.Save(m_state.file, m_state.info);
+                m_state.fileStatus = ok ? "Saved" : "Could not save the maze";
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Load", ImVec2(half, 0))) {
+                bool ok = m_worker.Load(m_state.file, &m_state.info);
+                if (ok) {
+                    m_maze.w = m_maze.maze.hcells;
+                    m_maze.h = m_maze.maze.vcells;
+                }
+                m_state.fileStatus = ok ? "Loaded" : "Not a maze file";
+            }
+            if (m_state.fileStatus)
+                ImGui::TextUnformatted(m_state.fileStatus);
 
             ImGui::PopItemWidth();
             if (!isIdle) ImGui::EndDisabled();
+
+            if (moved && m_state.solver == Solver::Type::DistanceField) {
+                Worker::Command c = {Worker::Command::Solve};
+                c.type = Solver::Type::DistanceField;
+                SwitchState(State::Solving, c);
+            }
+
+            if (!isIdle) {
+                auto &p = m_worker.progress;
+                ImGui::Text("Steps: %u in %.0fms", p.steps, p.ms);
+                ImGui::Text("Rate: %.0f steps/s", p.ms > 0 ? p.steps / p.ms * 1000 : 0.0f);
+                if (m_state.state == State::Solving) {
+                    snprintf(buf, 32, "Explored %.1f%%", p.explored * 100);
+                    ImGui::ProgressBar(p.explored, ImVec2(-1, 0), buf);
+                }
+                if (ImGui::Button("Cancel", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
+                    m_worker.Send({Worker::Command::Cancel});
+            } else if (m_worker.progress.cancelled) {
+                ImGui::TextUnformatted("Cancelled");
+            }
         }
 
         if (ImGui::TreeNodeEx("Animation", tflags))
         {
             ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
-            ImGui::Checkbox("Animate", &m_state.animate);
-            ImGui::SliderInt("##steptime", &m_state.step, 1, 100, "Time Per Step: %dms", ImGuiSliderFlags_AlwaysClamp);
+            bool changed = ImGui::Checkbox("Animate", &m_state.animate);
+            changed |= ImGui::SliderInt("##rate", &m_state.rate, 1, MAX_RATE, "Steps Per Second: %d",
+                    ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
             ImGui::PopItemWidth();
 
-            if (!m_state.animate && m_state.state != State::Idle) {
-                if (m_state.state == State::Generating)
-                    while (m_generator.Step());
-                else
-                    while (m_solver.Step());
-
-                SwitchState(State::Idle);
+            if (changed && m_worker.busy) {
+                Worker::Command c = {Worker::Command::Animate};
+                c.animate = m_state.animate;
+                c.rate = m_state.rate;
+                m_worker.Send(c);
             }
         }
 
@@ -175,15 +241,23 @@ private:
                 if (!btn || m_state.state != State::Idle)
                     return;
                 m_state.algo = n;
-                m_generator.Init(&m_maze.maze, type);
-                SwitchState(State::Generating);
+                Worker::Command c = {Worker::Command::Generate};
+                c.type = type;
+                c.seed = SDL_GetPerformanceCounter();
+                m_state.info = {type, c.seed};
+                m_state.solver = -1;
+                SwitchState(State::Generating, c);
             };
 
+            ImGui::Value("Disjoint Sets", m_worker.progress.setCount);
+            ImGui::Value("Set Tree Height", m_worker.progress.setHeight);
+
             GeneratorItem("Random"            , Generator::Type::Random           );
             GeneratorItem("Randomized DFS"    , Generator::Type::RandomizedDFS    );
             GeneratorItem("Recursive Division", Generator::Type::RecursiveDivision);
             GeneratorItem("Randomized Kruskal", Generator::Type::RandomizedKruskal);
             GeneratorItem("Randomized Prim"   , Generator::Type::RandomizedPrim   );
+            GeneratorItem("Eller's"           , Generator::Type::Eller            );
         }
 
         if (ImGui::TreeNodeEx("Solvers", tflags))
@@ -195,22 +269,26 @@ private:
             };
 
             Solver::Heuristic heuristicFuncs[] = {
-                [](int x0, int y0, int x1, int y1) -> float {
-                    (void)x0, (void)y0, (void)x1, (void)y1;
-                    return 0;
-                },
-
-                [](int x0, int y0, int x1, int y1) -> float {
-                    return abs(x1 - x0) + abs(y1 - y0);
-                },
-
-                [](int x0, int y0, int x1, int y1) -> float {
-                    return sqrtf((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
-                },
+                Heuristics::None,
+                Heuristics::Manhattan,
+                Heuristics::Euclidean,
             };
 
-            ImGui::Value("Vertices Expanded", m_solver.vertsExpanded);
-            ImGui::Value("Path Length", m_solver.pathLength);
+            ImGui::Value("Vertices Expanded", m_worker.progress.vertsExpanded);
+            ImGui::Value("Path Length", m_worker.progress.pathLength);
+            if (m_maze.maze.weights)
+                ImGui::Value("Path Cost", m_worker.progress.pathCost);
+
+            if (m_state.solver == Solver::Type::Hierarchical) {
+                auto &p = m_worker.progress;
+                auto &h = p.hierarchy;
+                ImGui::Text("Clusters: %u, %u rebuilt in %.2fms", h.clusters, h.rebuilt, h.buildMs);
+                ImGui::Text("Graph: %u nodes, %u edges", h.nodes, h.edges);
+                if (h.queryMs > 0 && h.flatMs > 0)
+                    ImGui::Text("Query: %.2fms, %.1fx plain A*'s %.2fms", h.queryMs, h.flatMs / h.queryMs, h.flatMs);
+                if (p.explored > 0)
+                    ImGui::Text("Visited %.2f%% of the open cells", p.explored * 100);
+            }
 
             ImGui::Combo("Heuristic", &m_state.heuristic, heuristicNames, 3);
 
@@ -219,9 +297,11 @@ private:
                 if (!btn || m_state.state != State::Idle)
                     return;
                 m_state.algo = n;
-                m_maze.maze.ClearPaths();
-                m_solver.Init(&m_maze.maze, t, heuristicFuncs[m_state.heuristic]);
-                SwitchState(State::Solving);
+                Worker::Command c = {Worker::Command::Solve};
+                c.type = t;
+                c.heuristic = heuristicFuncs[m_state.heuristic];
+                m_state.solver = t;
+                SwitchState(State::Solving, c);
             };
 
             SolverItem("Depth First Search"  , Solver::Type::DepthFirst     );
@@ -229,27 +309,18 @@ private:
             SolverItem("Dijkstra"            , Solver::Type::Dijkstra       );
             SolverItem("A*"                  , Solver::Type::AStar          );
             SolverItem("Greedy Best First"   , Solver::Type::GreedyBestFirst);
+            SolverItem("Bidirectional BFS"   , Solver::Type::BidirectionalBFS);
+            SolverItem("Bidirectional A*"    , Solver::Type::BidirectionalAStar);
+            SolverItem("Jump Point Search"   , Solver::Type::JumpPoint);
+            SolverItem("Parallel BFS"        , Solver::Type::ParallelBFS);
+            SolverItem("Wavefront Flood Fill", Solver::Type::Wavefront);
+            SolverItem("Goal Distance Field" , Solver::Type::DistanceField);
+            SolverItem("Lifelong Planning A*", Solver::Type::LifelongAStar);
+            SolverItem("Hierarchical A*"     , Solver::Type::Hierarchical);
+            SolverItem("Junction Graph A*"   , Solver::Type::Junction);
         }
 
         ImGui::End();
-
-        if (m_state.state != State::Idle) {
-            auto now = m_state.clock.now();
-            std::chrono::duration<float, std::milli> d = now - m_state.then;
-            m_state.time += d.count();
-            m_state.then = now;
-
-            bool resume = true;
-            if (m_state.state == State::Generating)
-                for (; m_state.time > 0 && resume; m_state.time -= m_state.step)
-                    resume = m_generator.Step();
-            else
-                for (; m_state.time > 0 && resume; m_state.time -= m_state.step)
-                    resume = m_solver.StepAndTrace();
-
-            if (!resume)
-                SwitchState(State::Idle);
-        }
     }
 
     void OnEvent(SDL_Event *event) override
@@ -290,7 +361,7 @@ private:
             before.y = cur.y / m_zoompan.zoom + m_zoompan.pan.y;
 
             if (event->wheel.y > 0 && m_zoompan.zoom < 256) m_zoompan.zoom *= 1.1f;
-            if (event->wheel.y < 0 && m_zoompan.zoom >   1) m_zoompan.zoom *= 0.9f;
+            if (event->wheel.y < 0 && m_zoompan.zoom > 1.0f / 64) m_zoompan.zoom *= 0.9f;
 
             after.x  = cur.x / m_zoompan.zoom + m_zoompan.pan.x;
             after.y  = cur.y / m_zoompan.zoom + m_zoompan.pan.y;
@@ -311,14 +382,18 @@ private:
             y += m_maze.h / 2.0f;
             int ix = (int)x, iy = (int)y;
 
-            if (m_maze.maze.PointInBounds(ix, iy))
-                m_maze.maze(ix, iy) = m_state.placeWalls ? WALL : PATH;
+            CellState c = m_state.placeWalls ? WALL : PATH;
+            if (m_maze.maze.PointInBounds(ix, iy)) {
+                if (m_state.paintTerrain)
+                    m_worker.Terrain(ix, iy, m_state.terrain);
+                else
+                    m_worker.Paint(ix, iy, c);
+            }
         }
     }
 
     void OnRender() override
     {
-        SDL_Rect src = { 0, 0, (int)(m_maze.w), (int)(m_maze.h) };
         SDL_FRect dst = {
             -(m_maze.w / 2.0f + m_zoompan.pan.x) * m_zoompan.zoom,
             -(m_maze.h / 2.0f + m_zoompan.pan.y) * m_zoompan.zoom,
@@ -326,42 +401,51 @@ private:
             m_maze.h * m_zoompan.zoom,
         };
 
-        SDL_Rect r = {0, 0, (int)m_maze.w, (int)m_maze.h};
-        auto ps = m_maze.maze(m_maze.maze.start.x, m_maze.maze.start.y);
-        auto pe = m_maze.maze(m_maze.maze.end  .x, m_maze.maze.end  .y);
-        m_maze.maze(m_maze.maze.start.x, m_maze.maze.start.y) = 0xb16286;
-        m_maze.maze(m_maze.maze.end  .x, m_maze.maze.end  .y) = 0xb8bb26;
-
-        SDL_UpdateTexture(m_maze.texture, &r, m_maze.maze.cells, 4 * m_maze.w);
-        SDL_RenderCopyF(m_renderer, m_maze.texture, &src, &dst);
-
-        m_maze.maze(m_maze.maze.start.x, m_maze.maze.start.y) = ps;
-        m_maze.maze(m_maze.maze.end  .x, m_maze.maze.end  .y) = pe;
-
-        float d = 0.2 * m_zoompan.zoom;
-        SDL_FRect rect = {0, 0, m_zoompan.zoom + 2 * d, m_zoompan.zoom + 2 * d};
-        rect.x = dst.x + m_maze.maze.start.x * m_zoompan.zoom - d;
-        rect.y = dst.y + m_maze.maze.start.y * m_zoompan.zoom - d;
-        SDL_SetRenderDrawColor(m_renderer, 0xb1, 0x62, 0x86, 0x00);
-        SDL_RenderDrawRectF(m_renderer, &rect);
-
-        rect.x = dst.x + m_maze.maze.end.x * m_zoompan.zoom - d;
-        rect.y = dst.y + m_maze.maze.end.y * m_zoompan.zoom - d;
-        SDL_SetRenderDrawColor(m_renderer, 0xb8, 0xbb, 0x26, 0x00);
-        SDL_RenderDrawRectF(m_renderer, &rect);
+        int vw, vh;
+        SDL_GetWindowSize(m_window, &vw, &vh);
+        m_maze.tiles.Draw(m_maze.maze, dst.x, dst.y, m_zoompan.zoom, vw, vh);
+
+        // start and end are drawn over the maze, at least a few pixels
+        // wide so they stay visible when zoomed out
+        auto marker = [this, &dst](int x, int y, Uint8 r, Uint8 g, Uint8 b) {
+            float s = SDL_max(m_zoompan.zoom, 4.0f);
+            float o = (s - m_zoompan.zoom) / 2;
+            SDL_FRect cell = {
+                dst.x + x * m_zoompan.zoom - o,
+                dst.y + y * m_zoompan.zoom - o,
+                s, s,
+            };
+            SDL_SetRenderDrawColor(m_renderer, r, g, b, 0x00);
+            SDL_RenderFillRectF(m_renderer, &cell);
+
+            float d = 0.2 * s;
+            SDL_FRect rect = {cell.x - d, cell.y - d, s + 2 * d, s + 2 * d};
+            SDL_RenderDrawRectF(m_renderer, &rect);
+        };
+
+        marker(m_maze.maze.start.x, m_maze.maze.start.y, 0xb1, 0x62, 0x86);
+        marker(m_maze.maze.end  .x, m_maze.maze.end  .y, 0xb8, 0xbb, 0x26);
+    }
+
+    void OnDestroy() override
+    {
+        m_maze.tiles.Destroy();
     }
 
-    void SwitchState(State::Enum state)
+    void SwitchState(State::Enum state, Worker::Command job)
     {
-        m_state.state = (State::Enum)state;
-        m_state.time  = 0;
-        m_state.then  = m_state.clock.now();
+        job.animate = m_state.animate;
+        job.rate = m_state.rate;
+        if (m_worker.Send(job))
+            m_state.state = state;
     }
 };
 
 int main(int argc, char **argv)
 {
-    (void) argc, (void)argv;
+    for (int i = 1; i < argc; i ++)
+        if (!strcmp(argv[i], "--headless"))
+            return RunHeadless(argc, argv);
 
     MazeApp app;
     if (app.Init())
@@ -1,44 +1,164 @@
 #include "maze.hpp"
 
-#include <assert.h>
-#include <SDL2/SDL_render.h>
+#include <string.h>
+#include <atomic>
 
-bool Maze::PointInBounds(int x, int y) {
-    return x >= 0 && y >= 0 && (unsigned)x < hcells && (unsigned)y < vcells;
+unsigned long long Maze::NewId() {
+    static std::atomic<unsigned long long> last{0};
+    return ++ last;
 }
 
-unsigned &Maze::operator() (int x, int y) {
-    if (!PointInBounds(x, y)) {
-        printf("%d %d\n", x, y);
-        assert(PointInBounds(x, y));
+void Maze::Fill(CellState s) {
+    allDirty = true;
+    wallEdits ++;
+    ClearWeights();
+    memset(walls, s == WALL ? 0xff : 0x00, (size_t)stride * vcells * sizeof(*walls));
+    if (marks)
+        memset(marks, s == WALL ? 0 : s * 0x55, ((size_t)hcells * vcells + 3) / 4);
+}
+
+void Maze::ClearPaths() {
+    allDirty = true;
+    if (marks)
+        memset(marks, 0, ((size_t)hcells * vcells + 3) / 4);
+}
+
+void Maze::ClearPaths(unsigned y, Span s) {
+    if (!marks || s.lo > s.hi)
+        return;
+
+    // cell by cell up to a byte boundary and after the last whole byte
+    size_t i = (size_t)y * hcells + s.lo;
+    size_t e = (size_t)y * hcells + s.hi + 1;
+    for (; i < e && (i & 3); i ++)
+        marks[i >> 2] &= ~(3 << ((i & 3) << 1));
+    size_t bytes = (e - i) >> 2;
+    memset(marks + (i >> 2), 0, bytes);
+    for (i += bytes << 2; i < e; i ++)
+        marks[i >> 2] &= ~(3 << ((i & 3) << 1));
+    Touch(s.lo, y);
+    Touch(s.hi, y);
+}
+
+void Maze::SetWeight(int x, int y, unsigned w) {
+    w = w < 1 ? 1 : w > MAX_WEIGHT ? MAX_WEIGHT : w;
+    size_t n = (size_t)hcells * vcells;
+    if (!weights) {
+        if (w == 1)
+            return;
+        weights = new uint8_t[n];
+        memset(weights, 1, n);
     }
-    return cells[y * hcells + x];
-};
+    weights[y * hcells + x] = w;
+    Touch(x, y);
+}
 
-void Maze::Fill(unsigned v) {
-    for (unsigned i = 0; i < hcells * vcells; i ++)
-        cells[i] = v;
+void Maze::ClearWeights() {
+    if (weights)
+        allDirty = true;
+    delete[] weights;
+    weights = nullptr;
 }
 
-void Maze::ClearPaths() {
-    for (unsigned i = 0; i < hcells * vcells; i ++)
-        cells[i] = cells[i] == WALL ? WALL : PATH;
+void Maze::ClearDirty() {
+    for (unsigned i = 0; i < ndirty; i ++)
+        dirty[dirtyRows[i]] = {1, 0};
+    ndirty = 0;
+    allDirty = false;
+}
+
+// Copies the cells written in from since its last ClearDirty and marks
+// them dirty here. Both mazes have the same size and already agree on
+// every other cell, so whole words of walls and bytes of marks can be
+// copied.
+void Maze::CopyDirty(Maze &from) {
+    assert(from.hcells == hcells && from.vcells == vcells && from.dirty);
+    start = from.start;
+    end = from.end;
+    wallEdits ++;
+
+    size_t n = (size_t)hcells * vcells;
+    if (!from.weights) {
+        ClearWeights();
+    } else if (!weights) {
+        weights = new uint8_t[n];
+        memcpy(weights, from.weights, n);
+        allDirty = true;
+    }
+
+    if (from.allDirty) {
+        memcpy(walls, from.walls, (size_t)stride * vcells * sizeof(*walls));
+        if (marks)
+            memcpy(marks, from.marks, (n + 3) / 4);
+        if (weights)
+            memcpy(weights, from.weights, n);
+        allDirty = true;
+        from.ClearDirty();
+        return;
+    }
+
+    for (unsigned i = 0; i < from.ndirty; i ++) {
+        unsigned y = from.dirtyRows[i];
+        Span s = from.dirty[y];
+
+        size_t w0 = (size_t)y * stride + (s.lo >> 6);
+        size_t w1 = (size_t)y * stride + (s.hi >> 6);
+        memcpy(walls + w0, from.walls + w0, (w1 - w0 + 1) * sizeof(*walls));
+        if (marks) {
+            size_t m0 = ((size_t)y * hcells + s.lo) >> 2;
+            size_t m1 = ((size_t)y * hcells + s.hi) >> 2;
+            memcpy(marks + m0, from.marks + m0, m1 - m0 + 1);
+        }
+        if (weights) {
+            size_t c = (size_t)y * hcells + s.lo;
+            memcpy(weights + c, from.weights + c, s.hi - s.lo + 1);
+        }
+        Touch(s.lo, y);
+        Touch(s.hi, y);
+    }
+    from.ClearDirty();
 }
 
-Maze::Maze(unsigned h, unsigned v) {
-    cells = nullptr;
+size_t Maze::Bytes() {
+    size_t b = (size_t)stride * vcells * sizeof(*walls);
+    if (marks)
+        b += ((size_t)hcells * vcells + 3) / 4;
+    if (weights)
+        b += (size_t)hcells * vcells;
+    return b;
+}
+
+Maze::Maze(unsigned h, unsigned v, bool visual) : visual(visual) {
     Resize(h, v);
 }
 
 void Maze::Resize(unsigned h, unsigned v) {
+    id = NewId();
     start.x = 0, start.y = 0;
     end.x = h - 1, end.y = v - 1;
     hcells = h, vcells = v;
-    delete[] cells;
-    cells = new unsigned[hcells * vcells];
+    stride = (h + 63) / 64;
+
+    Unmap();
+    delete[] walls;
+    delete[] marks;
+    delete[] dirty;
+    delete[] dirtyRows;
+    walls = new uint64_t[(size_t)stride * vcells];
+    marks = visual ? new uint8_t[((size_t)hcells * vcells + 3) / 4] : nullptr;
+    dirty = visual ? new Span[vcells] : nullptr;
+    dirtyRows = visual ? new unsigned[vcells] : nullptr;
+    ndirty = 0;
+    for (unsigned i = 0; dirty && i < vcells; i ++)
+        dirty[i] = {1, 0};
     Fill(PATH);
 }
 
 Maze::~Maze() {
-    delete []cells;
+    Unmap();
+    delete []walls;
+    delete []marks;
+    delete []weights;
+    delete []dirty;
+    delete []dirtyRows;
 }
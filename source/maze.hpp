@@ -1,28 +1,189 @@
 #pragma once
 
-#include <climits>
+#include <assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "stack.hpp"
 
-enum CellState : unsigned {
-    PATH = 0xfbf1c7,
-    WALL = 0x1d2021,
+// Walls are stored in a one bit per cell plane. Everything else is a
+// visualisation mark kept in an optional two bit per cell plane, colours
+// are only assigned when the maze is rendered.
+enum CellState : unsigned char {
+    PATH,
+    ACTIVE,
+    DEAD,
+    FOUND,
+    WALL,
 };
 
-struct SDL_Renderer;
+// Where a saved maze came from, kept in its file header.
+struct MazeInfo {
+    int generator = -1;           // Generator::Type, -1 when unknown
+    unsigned long long seed = 0;
+};
 
 struct Maze {
     unsigned hcells = 0;
     unsigned vcells = 0;
-    unsigned *cells = nullptr;
+    unsigned stride = 0;        // 64 bit words per row of walls
+    uint64_t *walls = nullptr;  // row padded bitset, padding bits unspecified
+    uint8_t  *marks = nullptr;  // 4 cells per byte, nullptr without visuals
+    uint8_t  *weights = nullptr; // per cell, nullptr while every cell costs 1
+    bool visual = true;
     struct { int x, y; } start = {0, 0};
     struct { int x, y; } end   = {0, 0};
 
+    // Cells written since the last ClearDirty, as one column span per row
+    // plus the list of rows that have one. Only tracked with visuals.
+    struct Span { unsigned lo, hi; };
+    Span     *dirty = nullptr;
+    unsigned *dirtyRows = nullptr;
+    unsigned  ndirty = 0;
+    bool      allDirty = true;
+
+    // Cost of stepping onto a cell, from 1 to MAX_WEIGHT. The weight plane
+    // is allocated by the first cell set heavier than 1 and dropped
+    // whenever the maze is filled, resized or loaded. Walls are not
+    // affected, so neither is wallEdits. Only Dijkstra and A* search by
+    // it, every other solver counts steps and only sums it along the path
+    // it found.
+    static constexpr unsigned MAX_WEIGHT = 9;
+
+    // Counts changes to the walls, caches of anything derived from them
+    // keep the count they were built at.
+    unsigned long long wallEdits = 0;
+
+    // Names the maze to those caches along with wallEdits, as its address
+    // may be taken by another maze with as many edits. Never reused within
+    // the process, and renewed whenever the maze is resized or loaded.
+    unsigned long long id = NewId();
+    static unsigned long long NewId();
+
+    // Set when walls point into a copy on write mapping of a file rather
+    // than the heap. The file is never written, pages are only copied
+    // once a wall on them changes.
+    void  *mapping = nullptr;
+    size_t mappingBytes = 0;
+
+    struct Cell {
+        Maze *maze;
+        int x, y;
+
+        operator CellState() const { return maze->Get(x, y); }
+        Cell &operator=(CellState s) { maze->Set(x, y, s); return *this; }
+        Cell &operator=(const Cell &c) { return *this = (CellState)c; }
+    };
+
      Maze() {}
-     Maze(unsigned h, unsigned v);
+     Maze(unsigned h, unsigned v, bool visual = true);
     ~Maze();
 
-    void Fill(unsigned);
+    void Fill(CellState);
     void Resize(unsigned h, unsigned v);
     void ClearPaths();
-    bool PointInBounds(int x, int y);
-    unsigned &operator() (int x, int y);
+    void ClearPaths(unsigned y, Span s); // row y from s.lo to s.hi
+    void SetWeight(int x, int y, unsigned w);
+    void ClearWeights();
+    void ClearDirty();
+    void CopyDirty(Maze &from);
+    size_t Bytes();
+
+    // Versioned binary file holding the walls as they are laid out in
+    // memory, see mazefile.cpp. Load maps the file instead of reading it.
+    bool Save(const char *path, const MazeInfo &info);
+    bool Load(const char *path, MazeInfo *info = nullptr);
+    void Unmap();
+
+    void Touch(int x, int y) {
+        if (!dirty || allDirty)
+            return;
+        Span &s = dirty[y];
+        if (s.lo > s.hi) {
+            s.lo = s.hi = x;
+            dirtyRows[ndirty ++] = y;
+        } else {
+            if ((unsigned)x < s.lo) s.lo = x;
+            if ((unsigned)x > s.hi) s.hi = x;
+        }
+    }
+
+    bool PointInBounds(int x, int y) {
+        return x >= 0 && y >= 0 && (unsigned)x < hcells && (unsigned)y < vcells;
+    }
+
+    bool IsWall(int x, int y) {
+        return (walls[y * stride + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    bool IsOpen(int x, int y) {
+        return PointInBounds(x, y) && !IsWall(x, y);
+    }
+
+    unsigned Weight(int x, int y) {
+        return weights ? weights[y * hcells + x] : 1;
+    }
+
+    CellState Get(int x, int y) {
+        if (IsWall(x, y))
+            return WALL;
+        if (!marks)
+            return PATH;
+        unsigned i = y * hcells + x;
+        return (CellState)((marks[i >> 2] >> ((i & 3) << 1)) & 3);
+    }
+
+    void Set(int x, int y, CellState s) {
+        // walls are only stored when they change, so marking the cells
+        // of a mapped maze leaves its pages shared
+        uint64_t &w = walls[y * stride + (x >> 6)];
+        uint64_t bit = (uint64_t)1 << (x & 63);
+        uint64_t v = s == WALL ? w | bit : w & ~bit;
+        if (v != w)
+            w = v, wallEdits ++;
+        if (s == WALL)
+            s = PATH;
+
+        if (marks) {
+            unsigned i = y * hcells + x;
+            unsigned shift = (i & 3) << 1;
+            marks[i >> 2] = (marks[i >> 2] & ~(3 << shift)) | (s << shift);
+        }
+        Touch(x, y);
+    }
+
+    Cell operator() (int x, int y) {
+        assert(PointInBounds(x, y));
+        return {this, x, y};
+    }
+};
+
+// The cells whose walls were written since a cache derived from the walls
+// of a maze was last brought up to date, for caches that repair
+// themselves around them. An edit that was not logged puts the log out of
+// step for good, and the cache has to start over.
+struct WallLog {
+    unsigned long long maze = 0;      // Maze::id
+    unsigned long long wallEdits = 0; // of the maze, with the logged cells
+    Stack<unsigned> cells;
+
+    // Logs the write of the wall at (x, y) of m, before is the wall edit
+    // count of m from just before.
+    void Log(Maze *m, int x, int y, unsigned long long before) {
+        if (m->id != maze || before != wallEdits)
+            return;
+        cells.Push(y * m->hcells + x);
+        wallEdits = m->wallEdits;
+    }
+
+    // Every wall edit of m since the last Sync was logged.
+    bool InStep(Maze *m) {
+        return m->id == maze && m->wallEdits == wallEdits;
+    }
+
+    // Takes the cache as up to date with m as it is now.
+    void Sync(Maze *m) {
+        maze = m->id;
+        wallEdits = m->wallEdits;
+        cells.Clear();
+    }
 };
@@ -0,0 +1,215 @@
+#include "maze.hpp"
+#include "bits.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// A maze file is this header followed, at offset, by the walls exactly as
+// Maze keeps them: stride 64 bit words per row, one bit per cell, padding
+// bits clear. Everything is little endian, a big endian host reads the
+// version wrong and refuses the file. The offset is kept a multiple of 64
+// so mapped walls are aligned like allocated ones.
+struct FileHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    int32_t  start[2];
+    int32_t  end[2];
+    int32_t  generator; // Generator::Type, -1 when unknown
+    uint32_t stride;
+    uint64_t seed;
+    uint64_t offset;    // of the walls, from the start of the file
+    uint64_t bytes;     // of the walls
+};
+static_assert(sizeof(FileHeader) == 64, "the header is laid out without padding");
+
+static const char MAGIC[4] = {'M', 'G', 'S', 'M'};
+static const uint32_t VERSION = 1;
+
+////////////////////////////////
+// Mapping
+////////////////////////////////
+
+// Maps a whole file copy on write, the file itself is never written.
+static void *MapFile(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    void *p = nullptr;
+    LARGE_INTEGER n;
+    if (GetFileSizeEx(f, &n) && n.QuadPart) {
+        HANDLE m = CreateFileMappingA(f, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (m) {
+            p = MapViewOfFile(m, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(m);
+        }
+        *size = (size_t)n.QuadPart;
+    }
+    CloseHandle(f);
+    return p;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    void *p = nullptr;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0) {
+        p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        p = p == MAP_FAILED ? nullptr : p;
+        *size = st.st_size;
+    }
+    close(fd);
+    return p;
+#endif
+}
+
+static void UnmapFile(void *p, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(p);
+#else
+    munmap(p, size);
+#endif
+}
+
+static bool Valid(const FileHeader &h, size_t size)
+{
+    if (size < sizeof(h) || memcmp(h.magic, MAGIC, 4) || h.version != VERSION)
+        return false;
+    // cells are indexed with unsigned everywhere, y * width + x may not wrap
+    if (!h.width || !h.height || (uint64_t)h.width * h.height > UINT32_MAX)
+        return false;
+    if (h.stride != ((uint64_t)h.width + 63) / 64)
+        return false;
+    if (h.bytes != (uint64_t)h.stride * h.height * sizeof(uint64_t))
+        return false;
+    if (h.offset < sizeof(h) || h.offset % 64 || h.offset > size || h.bytes > size - h.offset)
+        return false;
+
+    auto inside = [&h](const int32_t *p) {
+        return p[0] >= 0 && p[1] >= 0 && (uint32_t)p[0] < h.width && (uint32_t)p[1] < h.height;
+    };
+    return inside(h.start) && inside(h.end);
+}
+
+////////////////////////////////
+// Maze
+////////////////////////////////
+
+void Maze::Unmap()
+{
+    if (!mapping)
+        return;
+    UnmapFile(mapping, mappingBytes);
+    mapping = nullptr;
+    mappingBytes = 0;
+    walls = nullptr;
+}
+
+// Writes next to path and renames over it, so a file this or another
+// process has mapped is never truncated under it.
+bool Maze::Save(const char *path, const MazeInfo &info)
+{
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return false;
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return false;
+
+    FileHeader h = {};
+    memcpy(h.magic, MAGIC, 4);
+    h.version = VERSION;
+    h.width = hcells;
+    h.height = vcells;
+    h.start[0] = start.x, h.start[1] = start.y;
+    h.end[0] = end.x, h.end[1] = end.y;
+    h.generator = info.generator;
+    h.stride = stride;
+    h.seed = info.seed;
+    h.offset = sizeof(h);
+    h.bytes = (uint64_t)stride * vcells * sizeof(*walls);
+
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    auto row = new uint64_t[stride];
+    for (unsigned y = 0; ok && y < vcells; y ++) {
+        for (unsigned i = 0; i < stride; i ++)
+            row[i] = walls[(size_t)y * stride + i] & Bits::RowMask(i, stride, hcells);
+        ok = fwrite(row, sizeof(*row), stride, f) == stride;
+    }
+    delete [] row;
+
+    ok = !fclose(f) && ok;
+#ifdef _WIN32
+    // rename does not replace on Windows, nor does it while path is mapped
+    if (ok)
+        remove(path);
+#endif
+    ok = ok && !rename(tmp, path);
+    if (!ok)
+        remove(tmp);
+    return ok;
+}
+
+// Maps the file in place of the walls. Marks, when kept, start out clear
+// and are the only memory allocated, so loading costs about the same at
+// any size without visuals.
+bool Maze::Load(const char *path, MazeInfo *info)
+{
+    size_t size = 0;
+    void *p = MapFile(path, &size);
+    if (!p)
+        return false;
+
+    auto &h = *(const FileHeader *)p;
+    if (!Valid(h, size)) {
+        UnmapFile(p, size);
+        return false;
+    }
+
+    Unmap();
+    ClearWeights();
+    delete[] walls;
+    delete[] marks;
+    delete[] dirty;
+    delete[] dirtyRows;
+
+    hcells = h.width, vcells = h.height;
+    stride = h.stride;
+    start.x = h.start[0], start.y = h.start[1];
+    end.x = h.end[0], end.y = h.end[1];
+    mapping = p;
+    mappingBytes = size;
+    walls = (uint64_t *)((char *)p + h.offset);
+    wallEdits ++;
+    id = NewId();
+
+    marks = visual ? new uint8_t[((size_t)hcells * vcells + 3) / 4]() : nullptr;
+    dirty = visual ? new Span[vcells] : nullptr;
+    dirtyRows = visual ? new unsigned[vcells] : nullptr;
+    ndirty = 0;
+    for (unsigned i = 0; dirty && i < vcells; i ++)
+        dirty[i] = {1, 0};
+    allDirty = true;
+
+    if (info) {
+        info->generator = h.generator;
+        info->seed = h.seed;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <assert.h>
+
+// Array backed d-ary min heap of items ordered by their operator<. Unlike
+// Heap it keeps no per-id index, so it takes memory only for what is
+// queued. There is no decrease key: like Buckets, a better key is pushed
+// again, and the caller recognises and skips the entry left behind when it
+// comes out.
+template <typename T, unsigned D = 4>
+class MinHeap {
+public:
+    MinHeap() {}
+    ~MinHeap() {
+        delete [] items;
+    }
+
+    void Push(const T &item) {
+        if (size == capacity)
+            _grow();
+        items[size] = item;
+        _siftUp(size ++);
+    }
+
+    T Pop() {
+        assert(size);
+        T top = items[0];
+        if (-- size) {
+            items[0] = items[size];
+            _siftDown(0);
+        }
+        return top;
+    }
+
+    const T &Top() {
+        assert(size);
+        return items[0];
+    }
+
+    bool IsEmpty() {
+        return size == 0;
+    }
+
+    unsigned Size() {
+        return size;
+    }
+
+    void Clear() {
+        size = 0;
+    }
+
+private:
+    T *items = nullptr;
+    unsigned size = 0;
+    unsigned capacity = 0;
+
+    void _grow() {
+        capacity = capacity ? capacity * 2 : 64;
+        T *n = new T[capacity];
+        for (unsigned i = 0; i < size; i ++)
+            n[i] = items[i];
+        delete [] items;
+        items = n;
+    }
+
+    void _siftUp(unsigned at) {
+        T n = items[at];
+        while (at > 0) {
+            unsigned parent = (at - 1) / D;
+            if (!(n < items[parent]))
+                break;
+            items[at] = items[parent];
+            at = parent;
+        }
+        items[at] = n;
+    }
+
+    void _siftDown(unsigned at) {
+        T n = items[at];
+        for (;;) {
+            unsigned first = at * D + 1;
+            if (first >= size)
+                break;
+
+            unsigned last = first + D < size ? first + D : size;
+            unsigned best = first;
+            for (unsigned c = first + 1; c < last; c ++)
+                if (items[c] < items[best])
+                    best = c;
+
+            if (!(items[best] < n))
+                break;
+            items[at] = items[best];
+            at = best;
+        }
+        items[at] = n;
+    }
+};
@@ -0,0 +1,56 @@
+#include "nodesearch.hpp"
+#include "maze.hpp"
+
+#include <string.h>
+
+NodeSearch::~NodeSearch()
+{
+    delete [] m_g;
+    delete [] m_parent;
+}
+
+void NodeSearch::Begin(Maze *maze, Heuristics::Func h, unsigned n)
+{
+    for (unsigned i = 0; i < m_touched.Size(); i ++)
+        m_g[m_touched[i]] = INF;
+    m_touched.Clear();
+    m_open.Clear();
+    m_maze = maze;
+    m_h = h;
+
+    if (n <= m_capacity)
+        return;
+    delete [] m_g;
+    delete [] m_parent;
+    m_capacity = n * 2;
+    m_g      = new unsigned[m_capacity];
+    m_parent = new unsigned[m_capacity];
+    memset(m_g, 0xff, m_capacity * sizeof(*m_g));
+    m_open.Reserve(m_capacity);
+}
+
+void NodeSearch::Relax(unsigned id, unsigned cell, unsigned from, unsigned cost)
+{
+    if (cost >= m_g[id])
+        return;
+    if (m_g[id] == INF)
+        m_touched.Push(id);
+    m_g[id] = cost;
+    m_parent[id] = from;
+
+    int x = cell % m_maze->hcells, y = cell / m_maze->hcells;
+    float f = cost + m_h(x, y, m_maze->end.x, m_maze->end.y);
+    if (m_open.Contains(id)) {
+        m_open.Update(id, f);
+    } else {
+        m_open.Push(id, f);
+        (*m_maze)(x, y) = ACTIVE;
+    }
+}
+
+unsigned NodeSearch::Pop(unsigned goal)
+{
+    if (m_open.IsEmpty() || m_open.Top() == goal)
+        return INF;
+    return m_open.Pop();
+}
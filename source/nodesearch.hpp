@@ -0,0 +1,41 @@
+#pragma once
+
+#include "heap.hpp"
+#include "stack.hpp"
+#include "heuristic.hpp"
+
+struct Maze;
+
+// A* over the nodes of a graph laid on the cells of a maze, the search
+// half of HPAStar and JunctionGraph. They own the graph, expand the nodes
+// and relax the edges. This keeps g, the parents and the open set, and
+// marks the cells of the nodes it queues.
+class NodeSearch {
+public:
+    static constexpr unsigned INF = ~0u;
+
+     NodeSearch() {}
+    ~NodeSearch();
+
+    // Forgets the last search and makes room for nodes 0 to n - 1, headed
+    // for the end of maze.
+    void Begin(Maze *maze, Heuristics::Func h, unsigned n);
+    // Lowers the g of node id, on cell, to cost through node from and
+    // queues it. Does nothing unless cost is lower.
+    void Relax(unsigned id, unsigned cell, unsigned from, unsigned cost);
+    // Takes out the node to expand next, INF once there is none or goal
+    // would be next.
+    unsigned Pop(unsigned goal);
+
+    unsigned G(unsigned id) { return id < m_capacity ? m_g[id] : INF; }
+    unsigned Parent(unsigned id) { return m_parent[id]; }
+
+private:
+    Maze *m_maze = nullptr;
+    Heuristics::Func m_h = nullptr;
+    unsigned *m_g = nullptr;
+    unsigned *m_parent = nullptr;
+    unsigned m_capacity = 0;
+    Heap<float> m_open;
+    Stack<unsigned> m_touched; // nodes given a g, reset by Begin
+};
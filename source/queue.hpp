@@ -5,90 +5,60 @@
 template <typename T>
 class Queue {
 public:
-    typedef bool (*CompareFunc)(const T &a, const T &b);
-
-    Queue() : front(nullptr), rear(nullptr) {}
-    ~Queue() { Clear(); }
+    Queue() : data(nullptr), front(0), count(0), capacity(0) {}
+    ~Queue() { delete [] data; }
 
     void Enqueue(const T &s) {
-        Node *n = new Node(s, nullptr);
-        (!front) ?
-            rear = front = n :
-            rear->next = n, rear = n;
-    }
-
-    T PriorityDequeue() {
-        assert(front);
-        assert(cmp);
-
-        Node *trav = front->next;
-        Node *prev = front;
-        Node *dequeued = front;
-        Node *prevOfDequeued = nullptr;
-
-        while (trav != nullptr) {
-            if (cmp(trav->data, dequeued->data)) {
-                dequeued = trav;
-                prevOfDequeued = prev;
-            }
-            prev = trav;
-            trav = trav->next;
-        }
-
-        auto data = dequeued->data;
-
-        if (front == rear) {
-            front = rear = nullptr;
-        } else if (dequeued == front) {
-            front = front->next;
-        } else if (dequeued == rear) {
-            rear = prevOfDequeued;
-            rear->next = nullptr;
-        } else {
-            prevOfDequeued->next = dequeued->next;
-        }
-
-        delete dequeued;
-        return data;
+        if (count == capacity)
+            Reserve(capacity ? capacity * 2 : 64);
+        data[(front + count ++) & (capacity - 1)] = s;
     }
 
     T Dequeue() {
-        assert(front);
-        auto r = front->data;
-        auto n = front->next;
-
-        delete front;
-
-        (!n) ?
-            front = rear = nullptr :
-            front = n;
-
+        assert(count != 0);
+        auto r = data[front];
+        front = (front + 1) & (capacity - 1);
+        count --;
         return r;
     }
 
-    void SetCompareFunc(CompareFunc f) {
-        cmp = f;
+    T &Peek() {
+        assert(count != 0);
+        return data[front];
     }
 
     bool IsEmpty() {
-        return front == nullptr;
+        return count == 0;
+    }
+
+    unsigned Size() {
+        return count;
     }
 
     void Clear() {
-        cmp = nullptr;
-        while (!IsEmpty())
-            Dequeue();
+        front = count = 0;
     }
 
-private:
-    struct Node {
-        T data;
-        Node *next;
+    // capacity is kept at a power of two so that wrapping is a mask
+    void Reserve(unsigned n) {
+        if (n <= capacity)
+            return;
+        unsigned c = 64;
+        while (c < n)
+            c <<= 1;
+
+        T *d = new T[c];
+        for (unsigned i = 0; i < count; i ++)
+            d[i] = data[(front + i) & (capacity - 1)];
+        delete [] data;
+        data = d;
+        front = 0;
+        capacity = c;
+    }
 
-        Node(T d, Node *n) : data(d), next(n) {}
-    };
-    Node *front;
-    Node *rear;
-    CompareFunc cmp = nullptr;
+private:
+    T *data;
+    unsigned front;
+    unsigned count;
+    unsigned capacity;
 };
-
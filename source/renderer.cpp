@@ -0,0 +1,206 @@
+#include "renderer.hpp"
+#include "maze.hpp"
+
+#include <SDL2/SDL.h>
+
+// indexed by CellState
+static const unsigned PALETTE[] = {
+    0xfbf1c7, // PATH
+    0xcc241d, // ACTIVE
+    0xfabd2f, // DEAD
+    0x076678, // FOUND
+    0x1d2021, // WALL
+};
+
+// Open cells darken from PATH toward this as their terrain cost rises.
+static const unsigned TERRAIN = 0x7c6f64;
+
+static unsigned _colour(Maze &maze, int x, int y)
+{
+    CellState s = maze.Get(x, y);
+    unsigned w = maze.Weight(x, y);
+    if (s != PATH || w == 1)
+        return PALETTE[s];
+
+    // w - 1 of MAX_WEIGHT - 1 steps of the way, per channel
+    unsigned a = (w - 1) * 256 / (Maze::MAX_WEIGHT - 1), c = 0;
+    for (unsigned sh = 0; sh < 24; sh += 8) {
+        unsigned p = PALETTE[PATH] >> sh & 0xff, t = TERRAIN >> sh & 0xff;
+        c |= (p + (((int)t - (int)p) * (int)a >> 8)) << sh;
+    }
+    return c;
+}
+
+bool TileRenderer::Init(SDL_Renderer *renderer)
+{
+    m_renderer = renderer;
+    m_pixels = new unsigned[TILE * TILE];
+    for (auto &t : m_tiles) {
+        t.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, TILE, TILE);
+        if (!t.texture)
+            return false;
+    }
+    return true;
+}
+
+void TileRenderer::Destroy()
+{
+    for (auto &t : m_tiles) {
+        if (t.texture)
+            SDL_DestroyTexture(t.texture);
+        t = {};
+    }
+    delete [] m_pixels;
+    m_pixels = nullptr;
+}
+
+void TileRenderer::_drain(Maze &maze)
+{
+    if (maze.allDirty) {
+        for (auto &t : m_tiles)
+            t.stale = true;
+        maze.ClearDirty();
+        return;
+    }
+
+    for (unsigned i = 0; i < maze.ndirty; i ++) {
+        int y = maze.dirtyRows[i];
+        auto s = maze.dirty[y];
+
+        for (auto &t : m_tiles) {
+            if (t.lod < 0 || t.stale)
+                continue;
+
+            int span = TILE << t.lod;
+            int x0 = t.tx * span, y0 = t.ty * span;
+            if (y < y0 || y >= y0 + span || (int)s.hi < x0 || (int)s.lo >= x0 + span)
+                continue;
+
+            Rect r = {
+                SDL_max((int)s.lo, x0), y,
+                SDL_min((int)s.hi, x0 + span - 1), y,
+            };
+
+            Rect &d = t.dirty;
+            if (d.x1 < d.x0) {
+                d = r;
+            } else {
+                d.x0 = SDL_min(d.x0, r.x0), d.y0 = SDL_min(d.y0, r.y0);
+                d.x1 = SDL_max(d.x1, r.x1), d.y1 = SDL_max(d.y1, r.y1);
+            }
+        }
+    }
+    maze.ClearDirty();
+}
+
+TileRenderer::Tile *TileRenderer::_acquire(int lod, int tx, int ty)
+{
+    Tile *lru = &m_tiles[0];
+    for (auto &t : m_tiles) {
+        if (t.lod == lod && t.tx == tx && t.ty == ty)
+            return &t;
+        if (t.used < lru->used)
+            lru = &t;
+    }
+
+    lru->lod = lod, lru->tx = tx, lru->ty = ty;
+    lru->stale = true;
+    return lru;
+}
+
+// r is in texels of the tile, inclusive
+void TileRenderer::_fill(Maze &maze, Tile &t, Rect r)
+{
+    int span = TILE << t.lod;
+    int x0 = t.tx * span, y0 = t.ty * span;
+    int w = r.x1 - r.x0 + 1, h = r.y1 - r.y0 + 1;
+
+    if (t.lod == 0) {
+        for (int y = 0; y < h; y ++)
+            for (int x = 0; x < w; x ++)
+                m_pixels[y * w + x] = _colour(maze, x0 + r.x0 + x, y0 + r.y0 + y);
+    } else {
+        // average four samples per texel, offset by half a block so that
+        // both the cell and the wall lattice of grid mazes are represented
+        int o = 1 << (t.lod - 1);
+        for (int y = 0; y < h; y ++) {
+            for (int x = 0; x < w; x ++) {
+                int cx = x0 + ((r.x0 + x) << t.lod), cy = y0 + ((r.y0 + y) << t.lod);
+                int ax = cx + o < (int)maze.hcells ? cx + o : cx;
+                int ay = cy + o < (int)maze.vcells ? cy + o : cy;
+
+                unsigned s[4] = {
+                    _colour(maze, cx, cy), _colour(maze, ax, cy),
+                    _colour(maze, cx, ay), _colour(maze, ax, ay),
+                };
+
+                unsigned rb = 0, g = 0;
+                for (auto c : s) {
+                    rb += c & 0xff00ff;
+                    g  += c & 0x00ff00;
+                }
+                m_pixels[y * w + x] = ((rb >> 2) & 0xff00ff) | ((g >> 2) & 0x00ff00);
+            }
+        }
+    }
+
+    SDL_Rect sr = {r.x0, r.y0, w, h};
+    SDL_UpdateTexture(t.texture, &sr, m_pixels, 4 * w);
+    uploaded += w * h;
+}
+
+void TileRenderer::Draw(Maze &maze, float ox, float oy, float zoom, int vw, int vh)
+{
+    m_frame ++;
+    uploaded = 0;
+    _drain(maze);
+
+    int lod = 0;
+    while (zoom * (2 << lod) <= 1.0f && lod < 16)
+        lod ++;
+
+    int span = TILE << lod;
+    int tx0 = (int)SDL_floorf(-ox / zoom / span);
+    int ty0 = (int)SDL_floorf(-oy / zoom / span);
+    int tx1 = (int)SDL_floorf((vw - ox) / zoom / span);
+    int ty1 = (int)SDL_floorf((vh - oy) / zoom / span);
+
+    int ntx = (maze.hcells + span - 1) / span;
+    int nty = (maze.vcells + span - 1) / span;
+    tx0 = SDL_max(tx0, 0), tx1 = SDL_min(tx1, ntx - 1);
+    ty0 = SDL_max(ty0, 0), ty1 = SDL_min(ty1, nty - 1);
+
+    for (int ty = ty0; ty <= ty1; ty ++) {
+        for (int tx = tx0; tx <= tx1; tx ++) {
+            Tile *t = _acquire(lod, tx, ty);
+            t->used = m_frame;
+
+            // texels actually covered by the maze in this tile
+            int cw = SDL_min(span, (int)maze.hcells - tx * span);
+            int ch = SDL_min(span, (int)maze.vcells - ty * span);
+            int w  = (cw + (1 << lod) - 1) >> lod;
+            int h  = (ch + (1 << lod) - 1) >> lod;
+
+            if (t->stale) {
+                _fill(maze, *t, {0, 0, w - 1, h - 1});
+            } else if (t->dirty.x0 <= t->dirty.x1) {
+                int x0 = tx * span, y0 = ty * span;
+                _fill(maze, *t, {
+                    (t->dirty.x0 - x0) >> lod, (t->dirty.y0 - y0) >> lod,
+                    (t->dirty.x1 - x0) >> lod, (t->dirty.y1 - y0) >> lod,
+                });
+            }
+            t->stale = false;
+            t->dirty = {0, 0, -1, -1};
+
+            SDL_Rect src = {0, 0, w, h};
+            SDL_FRect dst = {
+                ox + tx * span * zoom,
+                oy + ty * span * zoom,
+                cw * zoom,
+                ch * zoom,
+            };
+            SDL_RenderCopyF(m_renderer, t->texture, &src, &dst);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+struct Maze;
+struct SDL_Renderer;
+struct SDL_Texture;
+
+// Draws a maze of any size through a fixed pool of texture tiles. Only
+// tiles that intersect the viewport are filled and drawn. When zoomed out
+// far enough that a cell is smaller than half a pixel, tiles are built at a
+// coarser level of detail where each texel summarises 2^lod x 2^lod cells.
+//
+// Cached tiles are kept up to date from the dirty rows of the maze, so a
+// frame only uploads the texels whose cells were written since the last
+// one. Draw consumes the dirty state of the maze.
+class TileRenderer {
+public:
+    static constexpr int TILE = 256;
+    static constexpr int MAX_TILES = 192;
+
+     TileRenderer() {}
+    ~TileRenderer() { Destroy(); }
+
+    bool Init(SDL_Renderer *renderer);
+    void Destroy();
+
+    // (ox, oy) is the screen position of the top left corner of cell
+    // (0, 0) and zoom the size of a cell in pixels.
+    void Draw(Maze &maze, float ox, float oy, float zoom, int vw, int vh);
+
+    // texels uploaded by the last Draw
+    unsigned uploaded = 0;
+
+private:
+    struct Rect { int x0, y0, x1, y1; };
+
+    struct Tile {
+        SDL_Texture *texture = nullptr;
+        int lod = -1, tx = 0, ty = 0;
+        unsigned used = 0;
+        bool stale = true;
+        Rect dirty = {0, 0, -1, -1}; // in cells, inclusive
+    };
+
+    SDL_Renderer *m_renderer = nullptr;
+    Tile m_tiles[MAX_TILES];
+    unsigned *m_pixels = nullptr;
+    unsigned m_frame = 0;
+
+    void _drain(Maze &maze);
+    Tile *_acquire(int lod, int tx, int ty);
+    void _fill(Maze &maze, Tile &t, Rect r);
+};
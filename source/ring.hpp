@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// Bounded queue between exactly two threads, one only pushing and the
+// other only popping. Neither side ever locks or waits, a full ring
+// refuses the push.
+template <typename T, unsigned N>
+class Ring {
+    static_assert(N && (N & (N - 1)) == 0, "capacity is kept at a power of two so that wrapping is a mask");
+
+public:
+    bool Push(const T &v) {
+        unsigned tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == N)
+            return false;
+        m_data[tail & (N - 1)] = v;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T &v) {
+        unsigned head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        v = m_data[head & (N - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // on separate cache lines so the two sides do not keep stealing
+    // each other's line
+    alignas(64) std::atomic<unsigned> m_head{0};
+    alignas(64) std::atomic<unsigned> m_tail{0};
+    T m_data[N];
+};
@@ -21,6 +21,14 @@ namespace RNG {
     static pcg32_random_t rng = {123456789, 987654321};
 }
 
+void RNG::Seed(unsigned long long seed) {
+    rng.state = 0;
+    rng.inc = 987654321;
+    pcg32_random_r(&rng);
+    rng.state += seed;
+    pcg32_random_r(&rng);
+}
+
 unsigned RNG::Get() {
     return pcg32_random_r(&rng);
 }
@@ -29,3 +37,18 @@ unsigned RNG::Get(unsigned l, unsigned h) {
     if (l > h) {auto t = l; l = h; h = t;}
     return l + pcg32_random_r(&rng) % (h - l + 1);
 }
+
+void RNG::Stream::Seed(unsigned long long seed, unsigned long long sequence) {
+    pcg32_random_t r = {0, (uint64_t)sequence << 1 | 1};
+    pcg32_random_r(&r);
+    r.state += seed;
+    pcg32_random_r(&r);
+    state = r.state, inc = r.inc;
+}
+
+unsigned RNG::Stream::Get() {
+    pcg32_random_t r = {state, inc};
+    unsigned v = pcg32_random_r(&r);
+    state = r.state;
+    return v;
+}
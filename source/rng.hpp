@@ -1,9 +1,22 @@
 #pragma once
 
+#include <stdint.h>
+
 namespace RNG {
+    void Seed(unsigned long long seed);
     unsigned Get();
     unsigned Get(unsigned l, unsigned h);
 
+    // A PCG32 generator apart from the global one. Each sequence number
+    // selects an independent stream for the same seed.
+    struct Stream {
+        uint64_t state = 0;
+        uint64_t inc = 1;
+
+        void Seed(unsigned long long seed, unsigned long long sequence);
+        unsigned Get();
+    };
+
     template <typename T>
     void Shuffle(unsigned n, T *a) {
         T temp;
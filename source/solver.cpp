@@ -1,86 +1,329 @@
 #include "solver.hpp"
 #include "maze.hpp"
+#include "bits.hpp"
+#include "heuristic.hpp"
+#include "floodfill.hpp"
+#include "lpastar.hpp"
+#include "hpastar.hpp"
+#include "junctions.hpp"
+#include "threadpool.hpp"
 
-#define ACTIVE  0xcc241d
-#define FOUND   0x076678
-#define DEAD    0xfabd2f
+#include <stdlib.h>
+#include <string.h>
 
 Solver:: Solver() {}
-Solver::~Solver() {_reset();}
+Solver::~Solver()
+{
+    _reset();
+    delete m_field;
+    delete m_lpa;
+    delete m_hpa;
+    delete m_junctions;
+    _free(m_vertices);
+    _free(m_rvertices);
+    delete m_pool;
+    delete [] m_lists;
+    delete [] m_visited;
+    delete [] m_front;
+    delete [] m_next;
+}
 
 void Solver::Init(Maze *maze, Type type, Heuristic h)
 {
     _reset();
+    assert(maze->marks && "solvers draw their progress in the mark plane");
     m_maze = maze;
     m_start  = { maze->start.x, maze->start.y };
     m_end    = { maze->end  .x, maze->end  .y };
     m_active = { maze->start.x, maze->start.y };
+    found = false;
     pathLength = 0;
+    pathCost = 0;
     vertsExpanded = 0;
-    m_vertices = new VertexData[maze->hcells * maze->vcells];
+    // solvers keeping state of their own
+    bool own = type == Wavefront || type == DistanceField || type == LifelongAStar
+            || type == Hierarchical || type == Junction;
+    if (!own) {
+        _alloc(m_vertices);
+        _generation();
+    }
     _heuristic = h;
+    m_type = type;
+    m_finished = false;
 
-#define CASE(_NAME) case Type::_NAME : _init##_NAME(); _step = &Solver::_step##_NAME; break
+#define CASE(_NAME) case Type::_NAME : _init##_NAME(); break
     switch (type) {
         CASE(AStar);
         CASE(Dijkstra);
         CASE(DepthFirst);
         CASE(BreadthFirst);
         CASE(GreedyBestFirst);
+        CASE(BidirectionalBFS);
+        CASE(BidirectionalAStar);
+        CASE(JumpPoint);
+        CASE(ParallelBFS);
+        CASE(Wavefront);
+        CASE(DistanceField);
+        CASE(LifelongAStar);
+        CASE(Hierarchical);
+        CASE(Junction);
     };
 #undef CASE
 }
 
-void Solver::_trace(unsigned t)
+// Grows v to the maze, new entries read as unreached from any generation.
+void Solver::_alloc(Vertices &v)
 {
-    pathLength = 0;
-    int x = m_active.x, y = m_active.y;
+    size_t n = (size_t)m_maze->hcells * m_maze->vcells;
+    if (n <= v.cells)
+        return;
+    _free(v);
+    v.g = new unsigned[n]();
+    v.dir = new uint8_t[(n + 3) >> 2];
+    v.cells = n;
+}
+
+void Solver::_free(Vertices &v)
+{
+    delete [] v.g;
+    delete [] v.dir;
+    v = {};
+}
+
+// Every g of a search is below its number of cells times the heaviest
+// step, so the next search starts past them. Once the counter would run
+// out, the stored values are zeroed and it starts over, once every 2^32 /
+// cells searches without weights.
+void Solver::_generation()
+{
+    uint64_t span = (uint64_t)m_maze->hcells * m_maze->vcells * (m_maze->weights ? Maze::MAX_WEIGHT : 1);
+    m_base += m_span;
+    m_span = span < INF ? (unsigned)span : INF - 1;
+    if (m_base <= INF - m_span)
+        return;
+    if (m_vertices.g)
+        memset(m_vertices.g, 0, m_vertices.cells * sizeof(*m_vertices.g));
+    if (m_rvertices.g)
+        memset(m_rvertices.g, 0, m_rvertices.cells * sizeof(*m_rvertices.g));
+    m_base = 1;
+}
+
+unsigned Solver::_g(const Vertices &v, unsigned i)
+{
+    unsigned g = v.g[i];
+    return g >= m_base ? g - m_base : INF;
+}
+
+void Solver::_setG(Vertices &v, unsigned i, unsigned g)
+{
+    v.g[i] = m_base + g;
+}
+
+unsigned char Solver::_dir(const Vertices &v, unsigned i)
+{
+    return v.dir[i >> 2] >> ((i & 3) << 1) & 3;
+}
+
+void Solver::_setDir(Vertices &v, unsigned i, unsigned char d)
+{
+    unsigned shift = (i & 3) << 1;
+    v.dir[i >> 2] = (v.dir[i >> 2] & ~(3 << shift)) | d << shift;
+}
+
+unsigned Solver::_walk(int x, int y, const Vertices &v, int tx, int ty, CellState t, unsigned &cost)
+{
+    unsigned n = 0;
     (*m_maze)(x, y) = t;
-    while (y != m_start.y || x != m_start.x) {
-        switch (m_vertices[y * m_maze->hcells + x].dir) {
+    cost += m_maze->Weight(x, y);
+    while (y != ty || x != tx) {
+        switch (_dir(v, y * m_maze->hcells + x)) {
             case L: x ++; break;
             case R: x --; break;
             case B: y ++; break;
             case T: y --; break;
-            default: x = m_start.x, y = m_start.y; break;
         }
-        pathLength ++;
+        n ++;
         (*m_maze)(x, y) = t;
+        cost += m_maze->Weight(x, y);
     }
+    return n;
 }
 
-bool Solver::Step()
+// Writes t along the path and sets pathLength, returns the summed weight
+// of its cells. Once found that is the path cost, plus the weight of the
+// start, which is never stepped onto.
+unsigned Solver::_trace(CellState t)
 {
-    bool res = (this->*_step)();
-    if (!res) {
-        _trace(FOUND);
-        _reset();
+    unsigned cost = 0;
+    if (m_type == DistanceField) {
+        bool reached = _fieldReady() && m_field->Reached(m_start.x, m_start.y);
+        pathLength = reached ? m_field->Trace(m_start.x, m_start.y, t, cost) : 0;
+    } else if (m_type == LifelongAStar) {
+        pathLength = m_lpa->Trace(m_active.x, m_active.y, t, cost);
+    } else if (m_type == Junction) {
+        pathLength = m_junctions->Trace(m_active.x, m_active.y, t, cost);
+    } else if (m_type == Hierarchical) {
+        pathLength = m_hpa->Trace(t, cost);
+        vertsExpanded = m_hpa->searched;
+        hierarchy.queryMs = m_hpa->queryMs;
+    } else if (m_type == JumpPoint) {
+        pathLength = _walkJumps(m_active.x, m_active.y, t, cost);
+    } else if (m_flood) {
+        pathLength = m_flood->Reached(m_active.x, m_active.y) ? m_flood->Trace(m_active.x, m_active.y, t, cost) : 0;
+    } else if (m_meet.found) {
+        auto &a = m_meet.a, &b = m_meet.b;
+        pathLength  = _walk(a.x, a.y, m_vertices , m_start.x, m_start.y, t, cost);
+        pathLength += _walk(b.x, b.y, m_rvertices, m_end  .x, m_end  .y, t, cost);
+        if (a.x != b.x || a.y != b.y)
+            pathLength ++;
+        else
+            cost -= m_maze->Weight(a.x, a.y); // walked from both sides
+    } else if (m_activeReverse) {
+        pathLength = _walk(m_active.x, m_active.y, m_rvertices, m_end.x, m_end.y, t, cost);
+    } else {
+        pathLength = _walk(m_active.x, m_active.y, m_vertices, m_start.x, m_start.y, t, cost);
     }
-    return res;
+    return cost;
+}
+
+bool Solver::Step()
+{
+    Step(1);
+    return !m_finished;
 }
 
 bool Solver::StepAndTrace()
 {
+    StepAndTrace(1);
+    return !m_finished;
+}
+
+template <bool (Solver::*S)()>
+unsigned Solver::_run(unsigned n)
+{
+    unsigned i = 0;
+    while (i < n) {
+        i ++;
+        if (!(this->*S)()) {
+            _finish();
+            break;
+        }
+    }
+    return i;
+}
+
+unsigned Solver::Step(unsigned n)
+{
+    if (m_finished)
+        return 0;
+
+    // kernels taking a heuristic are compiled once for each of Heuristics,
+    // any other heuristic runs the generic kernel calling through _heuristic
+#define CASE(_NAME) case Type::_NAME : return _run<&Solver::_step##_NAME>(n)
+#define KERNEL(_NAME, _H) _run<&Solver::_step##_NAME<_H>>(n)
+#define HCASE(_NAME) case Type::_NAME :                                                     \
+        if (_heuristic == Heuristics::Manhattan) return KERNEL(_NAME, Heuristics::Manhattan); \
+        if (_heuristic == Heuristics::Euclidean) return KERNEL(_NAME, Heuristics::Euclidean); \
+        if (_heuristic == Heuristics::None)      return KERNEL(_NAME, Heuristics::None);      \
+        return KERNEL(_NAME, nullptr)
+    switch (m_type) {
+        HCASE(AStar);
+        case Type::Dijkstra : return KERNEL(AStar, Heuristics::None);
+        CASE(DepthFirst);
+        CASE(BreadthFirst);
+        HCASE(GreedyBestFirst);
+        CASE(BidirectionalBFS);
+        HCASE(BidirectionalAStar);
+        HCASE(JumpPoint);
+        CASE(ParallelBFS);
+        CASE(Wavefront);
+        CASE(DistanceField);
+        CASE(LifelongAStar);
+        CASE(Hierarchical);
+        CASE(Junction);
+    };
+#undef HCASE
+#undef KERNEL
+#undef CASE
+    return 0;
+}
+
+unsigned Solver::StepAndTrace(unsigned n)
+{
+    if (m_finished)
+        return 0;
+
     _trace(DEAD);
-    bool res = (this->*_step)();
-    _trace(ACTIVE);
+    unsigned r = Step(n);
+    if (!m_finished)
+        _trace(ACTIVE);
+    return r;
+}
 
-    if (!res) {
-        _trace(FOUND);
-        _reset();
+unsigned Solver::RunFor(std::chrono::nanoseconds budget)
+{
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + budget;
+    unsigned total = 0, batch = 64;
+
+    while (!m_finished) {
+        total += Step(batch);
+        auto now = clock::now();
+        if (now >= deadline)
+            break;
+        // grow batches while far from the deadline to keep clock reads rare
+        if (deadline - now > budget / 2 && batch < (1u << 20))
+            batch <<= 1;
     }
-    return res;
+    return total;
+}
+
+void Solver::_finish()
+{
+    if (m_type == DistanceField)
+        found = _fieldReady() && m_field->Reached(m_start.x, m_start.y);
+    else if (m_type == LifelongAStar)
+        found = m_lpa->Found();
+    else if (m_type == Hierarchical)
+        found = m_hpa->Found();
+    else if (m_type == Junction)
+        found = m_junctions->Found();
+    else
+        found = m_meet.found || (!m_activeReverse && _isEnd(m_active.x, m_active.y));
+    unsigned cost = _trace(FOUND);
+    pathCost = found ? cost - m_maze->Weight(m_start.x, m_start.y) : 0;
+    _reset();
+    m_finished = true;
 }
 
 void Solver::_reset()
 {
     m_maze = nullptr;
-    m_finished = false;
     m_active = {0, 0};
-    delete [] m_vertices;
-    m_vertices = nullptr;
+    m_activeReverse = false;
+    m_meet = {};
     m_stack.Clear();
     m_queue.Clear();
+    m_heap.Clear();
+    m_buckets.Clear();
+    m_rqueue.Clear();
+    m_rheap.Clear();
+    m_frontier = 0;
+
+    delete m_flood;
+    m_flood = nullptr;
+}
+
+template <Solver::Heuristic H>
+inline float Solver::_h(int x0, int y0, int x1, int y1)
+{
+    return H(x0, y0, x1, y1);
+}
+
+template <>
+inline float Solver::_h<nullptr>(int x0, int y0, int x1, int y1)
+{
+    return _heuristic(x0, y0, x1, y1);
 }
 
 bool Solver::_isEnd(int x, int y)
@@ -88,6 +331,17 @@ bool Solver::_isEnd(int x, int y)
     return x == m_end.x && y == m_end.y;
 }
 
+void Solver::_meetAt(bool forward, int x0, int y0, int x1, int y1, float cost)
+{
+    if (m_meet.found && m_meet.cost <= cost)
+        return;
+
+    m_meet.found = true;
+    m_meet.cost = cost;
+    m_meet.a = forward ? decltype(m_meet.a){x0, y0} : decltype(m_meet.a){x1, y1};
+    m_meet.b = forward ? decltype(m_meet.b){x1, y1} : decltype(m_meet.b){x0, y0};
+}
+
 ////////////////////////////////
 // Depth First Search
 ////////////////////////////////
@@ -98,6 +352,7 @@ void Solver::_initDepthFirst()
     int y = m_start.y;
     Sitem s = {x, y};
     m_stack.Push(s);
+    _setG(m_vertices, y * m_maze->hcells + x, 0);
     (*m_maze)(x, y) = ACTIVE;
 }
 
@@ -113,9 +368,11 @@ bool Solver::_stepDepthFirst()
         return false;
 
     auto push = [this](int x, int y, unsigned char dir) {
-        if (!m_maze->PointInBounds(x, y) || (*m_maze)(x, y) != PATH)
+        unsigned i = y * m_maze->hcells + x;
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y) || _g(m_vertices, i) != INF)
             return;
-        m_vertices[y * m_maze->hcells + x].dir = dir;
+        _setG(m_vertices, i, 0);
+        _setDir(m_vertices, i, dir);
         m_stack.Push({x, y});
         (*m_maze)(x, y) = ACTIVE;
     };
@@ -136,8 +393,9 @@ void Solver::_initBreadthFirst()
 {
     int x = m_start.x;
     int y = m_start.y;
-    Qitem q = {x, y, 0};
+    Qitem q = {x, y};
     m_queue.Enqueue(q);
+    _setG(m_vertices, y * m_maze->hcells + x, 0);
     (*m_maze)(x, y) = ACTIVE;
 }
 
@@ -153,11 +411,13 @@ bool Solver::_stepBreadthFirst()
         return false;
 
     auto enqueue = [this](int x, int y, unsigned char dir) {
-        if (!m_maze->PointInBounds(x, y) || (*m_maze)(x, y) != PATH)
+        unsigned i = y * m_maze->hcells + x;
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y) || _g(m_vertices, i) != INF)
             return;
 
-        m_vertices[y * m_maze->hcells + x].dir = dir;
-        Qitem q = {x, y, 0};
+        _setG(m_vertices, i, 0);
+        _setDir(m_vertices, i, dir);
+        Qitem q = {x, y};
         m_queue.Enqueue(q);
         (*m_maze)(x, y) = ACTIVE;
     };
@@ -178,95 +438,192 @@ void Solver::_initDijkstra()
 {
     int x = m_start.x;
     int y = m_start.y;
-    m_vertices[y * m_maze->hcells + x].gval = 0;
+    unsigned i = y * m_maze->hcells + x;
+    _setG(m_vertices, i, 0);
     (*m_maze)(x, y) = ACTIVE;
+    m_buckets.Push(0, {i, 0});
+}
 
-    Qitem q = {x, y, m_vertices};
-    m_queue.Enqueue(q);
+// Steps with _stepAStar<Heuristics::None>, with h = 0 the A* key is g.
 
-    m_queue.SetCompareFunc([](auto a, auto b) -> bool {
-        return a.v->gval < b.v->gval;
-    });
+////////////////////////////////
+// Greedy Best First Search
+////////////////////////////////
+
+void Solver::_initGreedyBestFirst()
+{
+    int x = m_start.x;
+    int y = m_start.y;
+    unsigned i = y * m_maze->hcells + x;
+    _setG(m_vertices, i, 0);
+    (*m_maze)(x, y) = ACTIVE;
+
+    m_heap.Push({_heuristic(x, y, m_end.x, m_end.y), i, 0});
 }
 
-bool Solver::_stepDijkstra()
+template <Solver::Heuristic H>
+bool Solver::_stepGreedyBestFirst()
 {
-    if (m_queue.IsEmpty())
+    // cells are queued once, when first reached
+    if (m_heap.IsEmpty())
         return false;
 
-    auto i = m_queue.PriorityDequeue();
+    auto i = m_heap.Pop().i;
+    int  x = i % m_maze->hcells;
+    int  y = i / m_maze->hcells;
     vertsExpanded ++;
-    m_active = {i.x, i.y};
-    if (_isEnd(i.x, i.y))
+    m_active = {x, y};
+    if (_isEnd(x, y))
         return false;
 
-    auto gval = i.v->gval + 1;
-    auto enqueue = [this, gval](int x, int y, unsigned char dir) {
-        if (!m_maze->PointInBounds(x, y) || (*m_maze)(x, y) == WALL)
+    auto enqueue = [this](int x, int y, unsigned char dir) {
+        unsigned i = y * m_maze->hcells + x;
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y) || _g(m_vertices, i) != INF)
             return;
 
-        auto &vert = m_vertices[y * m_maze->hcells + x];
-        if (vert.gval == -1 || vert.gval > gval) {
-            vert.gval = gval;
-            vert.dir  = dir;
-        }
-
-        if ((*m_maze)(x, y) == PATH) {
-            (*m_maze)(x, y) = ACTIVE;
-            Qitem q = {x, y, &vert};
-            m_queue.Enqueue(q);
-        }
+        _setG(m_vertices, i, 0);
+        _setDir(m_vertices, i, dir);
+        m_heap.Push({_h<H>(x, y, m_end.x, m_end.y), i, 0});
+        (*m_maze)(x, y) = ACTIVE;
     };
 
-    (*m_maze)(i.x, i.y) = DEAD;
-    enqueue(i.x - 1, i.y, L);
-    enqueue(i.x + 1, i.y, R);
-    enqueue(i.x, i.y - 1, B);
-    enqueue(i.x, i.y + 1, T);
+    (*m_maze)(x, y) = DEAD;
+    enqueue(x - 1, y, L);
+    enqueue(x + 1, y, R);
+    enqueue(x, y - 1, B);
+    enqueue(x, y + 1, T);
     return true;
 }
 
 ////////////////////////////////
-// Greedy Best First Search
+// A*
 ////////////////////////////////
 
-void Solver::_initGreedyBestFirst()
+// A step costs the weight of the cell stepped onto, an integer from 1 to
+// Maze::MAX_WEIGHT, so g is an integer and so is f = g + floor(h). The
+// floor of a consistent heuristic is consistent too, so f never drops
+// along the search and rises by at most MAX_WEIGHT + 1 from one cell to
+// the next. The open set is a bucket queue over f rather than a heap.
+
+static_assert(Maze::MAX_WEIGHT + 1 < 16, "a step stays within the buckets");
+
+void Solver::_initAStar()
 {
     int x = m_start.x;
     int y = m_start.y;
-    m_vertices[y * m_maze->hcells + x].hval = _heuristic(x, y, m_end.x, m_end.y);
+    unsigned i = y * m_maze->hcells + x;
+    _setG(m_vertices, i, 0);
     (*m_maze)(x, y) = ACTIVE;
+    m_buckets.Push((unsigned)_heuristic(x, y, m_end.x, m_end.y), {i, 0});
+}
 
-    Qitem q = {x, y, m_vertices};
-    m_queue.Enqueue(q);
+template <Solver::Heuristic H>
+bool Solver::_stepAStar()
+{
+    // entries left behind when a cell was queued again at a lower g are
+    // skipped
+    unsigned i, f;
+    for (;;) {
+        if (m_buckets.IsEmpty())
+            return false;
+        auto b = m_buckets.Pop(f);
+        i = b.i;
+        if (b.g == _g(m_vertices, i))
+            break;
+    }
 
-    m_queue.SetCompareFunc([](auto a, auto b) -> bool {
-        return a.v->hval < b.v->hval;
-    });
+    int  x = i % m_maze->hcells;
+    int  y = i / m_maze->hcells;
+    vertsExpanded ++;
+    m_active = {x, y};
+    if (_isEnd(x, y))
+        return false;
+
+    unsigned gval = _g(m_vertices, i);
+    auto enqueue = [this, gval](int x, int y, unsigned char dir) {
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y))
+            return;
+
+        unsigned i = y * m_maze->hcells + x;
+        unsigned g = gval + m_maze->Weight(x, y);
+        unsigned old = _g(m_vertices, i);
+        if (old <= g)
+            return;
+
+        _setG(m_vertices, i, g);
+        _setDir(m_vertices, i, dir);
+        m_buckets.Push(g + (unsigned)_h<H>(x, y, m_end.x, m_end.y), {i, g});
+        if (old == INF)
+            (*m_maze)(x, y) = ACTIVE;
+    };
+
+    (*m_maze)(x, y) = DEAD;
+    enqueue(x - 1, y, L);
+    enqueue(x + 1, y, R);
+    enqueue(x, y - 1, B);
+    enqueue(x, y + 1, T);
+    return true;
 }
 
-bool Solver::_stepGreedyBestFirst()
+////////////////////////////////
+// Bidirectional BFS
+////////////////////////////////
+
+void Solver::_initBidirectionalBFS()
 {
-    if (m_queue.IsEmpty())
+    unsigned n = m_maze->hcells;
+    _alloc(m_rvertices);
+    _setG(m_vertices, m_start.y * n + m_start.x, 0);
+    _setG(m_rvertices, m_end  .y * n + m_end  .x, 0);
+
+    m_queue .Enqueue({m_start.x, m_start.y});
+    m_rqueue.Enqueue({m_end  .x, m_end  .y});
+    (*m_maze)(m_start.x, m_start.y) = ACTIVE;
+    (*m_maze)(m_end  .x, m_end  .y) = ACTIVE;
+
+    if (_isEnd(m_start.x, m_start.y))
+        _meetAt(true, m_start.x, m_start.y, m_end.x, m_end.y, 0);
+}
+
+bool Solver::_stepBidirectionalBFS()
+{
+    if (m_queue.IsEmpty() || m_rqueue.IsEmpty())
+        return false;
+
+    // every path not seen yet is at least as long as the two queue fronts
+    unsigned n = m_maze->hcells;
+    auto &f = m_queue.Peek(), &r = m_rqueue.Peek();
+    float bound = _g(m_vertices, f.y * n + f.x) + _g(m_rvertices, r.y * n + r.x);
+    if (m_meet.found && m_meet.cost <= bound)
         return false;
 
-    auto i = m_queue.PriorityDequeue();
+    // expand the smaller frontier
+    bool forward = m_queue.Size() <= m_rqueue.Size();
+    auto &queue = forward ? m_queue : m_rqueue;
+    auto &own   = forward ? m_vertices : m_rvertices;
+    auto &other = forward ? m_rvertices : m_vertices;
+
+    auto i = queue.Dequeue();
     vertsExpanded ++;
     m_active = {i.x, i.y};
-    if (_isEnd(i.x, i.y))
-        return false;
+    m_activeReverse = !forward;
 
-    auto enqueue = [this](int x, int y, unsigned char dir) {
-        if (!m_maze->PointInBounds(x, y) || (*m_maze)(x, y) != PATH)
+    unsigned gval = _g(own, i.y * n + i.x) + 1;
+    auto enqueue = [&](int x, int y, unsigned char dir) {
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y))
             return;
 
-        auto i = y * m_maze->hcells + x;
-        m_vertices[i].dir  = dir;
-        m_vertices[i].hval = _heuristic(x, y, m_end.x, m_end.y);
+        unsigned j = y * n + x;
+        if (_g(other, j) != INF)
+            _meetAt(forward, i.x, i.y, x, y, gval + _g(other, j));
+        if (_g(own, j) != INF)
+            return;
 
-        Qitem q = {x, y, &m_vertices[i]};
-        m_queue.Enqueue(q);
-        (*m_maze)(x, y) = ACTIVE;
+        _setG(own, j, gval);
+        _setDir(own, j, dir);
+        queue.Enqueue({x, y});
+        if ((*m_maze)(x, y) == PATH)
+            (*m_maze)(x, y) = ACTIVE;
     };
 
     (*m_maze)(i.x, i.y) = DEAD;
@@ -278,59 +635,683 @@ bool Solver::_stepGreedyBestFirst()
 }
 
 ////////////////////////////////
-// A*
+// Bidirectional A*
 ////////////////////////////////
 
-void Solver::_initAStar()
+void Solver::_initBidirectionalAStar()
+{
+    unsigned n = m_maze->hcells;
+    unsigned s = m_start.y * n + m_start.x;
+    unsigned e = m_end  .y * n + m_end  .x;
+    _alloc(m_rvertices);
+
+    _setG(m_vertices, s, 0);
+    _setG(m_rvertices, e, 0);
+
+    m_heap .Push({_heuristic(m_start.x, m_start.y, m_end.x, m_end.y), s, 0});
+    m_rheap.Push({_heuristic(m_end.x, m_end.y, m_start.x, m_start.y), e, 0});
+    (*m_maze)(m_start.x, m_start.y) = ACTIVE;
+    (*m_maze)(m_end  .x, m_end  .y) = ACTIVE;
+
+    if (s == e)
+        _meetAt(true, m_start.x, m_start.y, m_end.x, m_end.y, 0);
+}
+
+template <Solver::Heuristic H>
+bool Solver::_stepBidirectionalAStar()
+{
+    // entries left behind when a cell was queued again at a lower g are
+    // dropped from the top, so both tops are open cells
+    auto prune = [this](MinHeap<Hitem> &heap, const Vertices &v) {
+        while (!heap.IsEmpty() && heap.Top().g != _g(v, heap.Top().i))
+            heap.Pop();
+    };
+    prune(m_heap, m_vertices);
+    prune(m_rheap, m_rvertices);
+    if (m_heap.IsEmpty() || m_rheap.IsEmpty())
+        return false;
+
+    // with a consistent heuristic the smallest f of either side is a lower
+    // bound on every path not seen yet
+    if (m_meet.found && (m_meet.cost <= m_heap.Top().f || m_meet.cost <= m_rheap.Top().f))
+        return false;
+
+    bool forward = m_heap.Size() <= m_rheap.Size();
+    auto &heap  = forward ? m_heap : m_rheap;
+    auto &own   = forward ? m_vertices : m_rvertices;
+    auto &other = forward ? m_rvertices : m_vertices;
+    int  gx     = forward ? m_end.x : m_start.x;
+    int  gy     = forward ? m_end.y : m_start.y;
+
+    unsigned n = m_maze->hcells;
+    auto i = heap.Pop().i;
+    int  x = i % n;
+    int  y = i / n;
+    vertsExpanded ++;
+    m_active = {x, y};
+    m_activeReverse = !forward;
+
+    unsigned gval = _g(own, i) + 1;
+    auto enqueue = [&](int x1, int y1, unsigned char dir) {
+        if (!m_maze->PointInBounds(x1, y1) || m_maze->IsWall(x1, y1))
+            return;
+
+        unsigned j = y1 * n + x1;
+        if (_g(other, j) != INF)
+            _meetAt(forward, x, y, x1, y1, gval + _g(other, j));
+        if (_g(own, j) <= gval)
+            return;
+
+        _setG(own, j, gval);
+        _setDir(own, j, dir);
+
+        heap.Push({gval + _h<H>(x1, y1, gx, gy), j, gval});
+        if ((*m_maze)(x1, y1) == PATH)
+            (*m_maze)(x1, y1) = ACTIVE;
+    };
+
+    (*m_maze)(x, y) = DEAD;
+    enqueue(x - 1, y, L);
+    enqueue(x + 1, y, R);
+    enqueue(x, y - 1, B);
+    enqueue(x, y + 1, T);
+    return true;
+}
+
+////////////////////////////////
+// Jump Point Search
+////////////////////////////////
+
+// Jump point search adapted to 4-connected grids. Canonical paths move
+// vertically before horizontally: a vertical move may be followed by a
+// move in any direction but back, a horizontal move only by the same move
+// unless a wall forces a turn. Vertical jumps therefore scan horizontally
+// from every cell they pass, the way diagonal jumps scan straight in the
+// 8-connected version.
+
+bool Solver::_jumpH(int x, int y, int dx, int &jx)
+{
+    for (;;) {
+        x += dx;
+        if (!m_maze->IsOpen(x, y))
+            return false;
+
+        bool forced = (m_maze->IsOpen(x, y - 1) && !m_maze->IsOpen(x - dx, y - 1))
+                   || (m_maze->IsOpen(x, y + 1) && !m_maze->IsOpen(x - dx, y + 1));
+        if (forced || _isEnd(x, y)) {
+            jx = x;
+            return true;
+        }
+    }
+}
+
+bool Solver::_jumpV(int x, int y, int dy, int &jy)
+{
+    int t;
+    for (;;) {
+        y += dy;
+        if (!m_maze->IsOpen(x, y))
+            return false;
+
+        if (_isEnd(x, y) || _jumpH(x, y, -1, t) || _jumpH(x, y, 1, t)) {
+            jy = y;
+            return true;
+        }
+    }
+}
+
+// Only jump points get a g-value. Walks the chain of jump points back
+// from (x, y), each jump cell by cell against its direction up to the
+// first cell no further from the start than the jump makes it: the jump
+// point it was made from, or one reached as cheaply since. Writes t along
+// the way and returns the length, adding the weights of the cells to cost.
+// Reads the search state only, tracing between steps leaves the search as
+// it was.
+unsigned Solver::_walkJumps(int x, int y, CellState t, unsigned &cost)
+{
+    unsigned n = m_maze->hcells, len = 0;
+    (*m_maze)(x, y) = t;
+    cost += m_maze->Weight(x, y);
+    while (x != m_start.x || y != m_start.y) {
+        unsigned g = _g(m_vertices, y * n + x);
+        if (g == INF)
+            break;
+
+        unsigned char dir = _dir(m_vertices, y * n + x);
+        int bx = dir == L ? 1 : dir == R ? -1 : 0;
+        int by = dir == B ? 1 : dir == T ? -1 : 0;
+        for (unsigned k = 1; ; k ++) {
+            x += bx, y += by;
+            assert(m_maze->PointInBounds(x, y));
+            (*m_maze)(x, y) = t;
+            cost += m_maze->Weight(x, y);
+            len ++;
+            if (_g(m_vertices, y * n + x) <= g - k)
+                break;
+        }
+    }
+    return len;
+}
+
+void Solver::_initJumpPoint()
 {
     int x = m_start.x;
     int y = m_start.y;
-    m_vertices[y * m_maze->hcells + x].gval = 0;
-    m_vertices[y * m_maze->hcells + x].hval = _heuristic(x, y, m_end.x, m_end.y);
+    unsigned i = y * m_maze->hcells + x;
+    _setG(m_vertices, i, 0);
     (*m_maze)(x, y) = ACTIVE;
 
-    Qitem q = {x, y, m_vertices};
-    m_queue.Enqueue(q);
-
-    m_queue.SetCompareFunc([](auto a, auto b) -> bool {
-        return (a.v->gval + a.v->hval) < (b.v->gval + b.v->hval);
-    });
+    m_heap.Push({_heuristic(x, y, m_end.x, m_end.y), i, 0});
+    m_tie = 1.0f / (m_maze->hcells + m_maze->vcells + 1);
 }
 
-bool Solver::_stepAStar()
+template <Solver::Heuristic H>
+bool Solver::_stepJumpPoint()
 {
-    if (m_queue.IsEmpty())
-        return false;
+    // entries left behind when a jump point was queued again at a lower g
+    // are skipped
+    unsigned n = m_maze->hcells;
+    unsigned i;
+    for (;;) {
+        if (m_heap.IsEmpty())
+            return false;
+        auto h = m_heap.Pop();
+        i = h.i;
+        if (h.g == _g(m_vertices, i))
+            break;
+    }
 
-    auto i = m_queue.PriorityDequeue();
+    int  x = i % n;
+    int  y = i / n;
     vertsExpanded ++;
-    m_active = {i.x, i.y};
-    if (_isEnd(i.x, i.y))
+    m_active = {x, y};
+    if (_isEnd(x, y))
         return false;
 
-    auto gval = i.v->gval + 1;
-    auto enqueue = [this, gval](int x, int y, unsigned char dir) {
-        if (!m_maze->PointInBounds(x, y) || (*m_maze)(x, y) == WALL)
+    unsigned gval = _g(m_vertices, i);
+    auto relax = [&](int x1, int y1, unsigned char dir) {
+        unsigned g = gval + abs(x1 - x) + abs(y1 - y);
+        unsigned j = y1 * n + x1;
+        if (_g(m_vertices, j) <= g)
             return;
 
-        auto &vert = m_vertices[y * m_maze->hcells + x];
-        if (vert.gval == -1 || vert.gval > gval) {
-            vert.gval = gval;
-            vert.dir  = dir;
+        _setG(m_vertices, j, g);
+        _setDir(m_vertices, j, dir);
+
+        m_heap.Push({g + _h<H>(x1, y1, m_end.x, m_end.y) * (1 + m_tie), j, g});
+        if ((*m_maze)(x1, y1) == PATH)
+            (*m_maze)(x1, y1) = ACTIVE;
+    };
+
+    auto horizontal = [&](int dx) {
+        int jx;
+        if (_jumpH(x, y, dx, jx))
+            relax(jx, y, dx < 0 ? L : R);
+    };
+
+    auto vertical = [&](int dy) {
+        int jy;
+        if (_jumpV(x, y, dy, jy))
+            relax(x, jy, dy < 0 ? B : T);
+    };
+
+    (*m_maze)(x, y) = DEAD;
+    auto dir = _dir(m_vertices, i);
+    if (x == m_start.x && y == m_start.y) {
+        horizontal(-1);
+        horizontal( 1);
+        vertical(-1);
+        vertical( 1);
+    } else if (dir == L || dir == R) {
+        int dx = dir == L ? -1 : 1;
+        horizontal(dx);
+        for (int dy = -1; dy <= 1; dy += 2)
+            if (m_maze->IsOpen(x, y + dy) && !m_maze->IsOpen(x - dx, y + dy))
+                vertical(dy);
+    } else {
+        vertical(dir == B ? -1 : 1);
+        horizontal(-1);
+        horizontal( 1);
+    }
+    return true;
+}
+
+////////////////////////////////
+// Parallel Breadth First Search
+////////////////////////////////
+
+// Level synchronous BFS, each step expands a whole frontier across the
+// thread pool. Frontier cells claim their unvisited neighbours in an
+// atomic bitmap (top down). Once the frontier is large next to what is
+// left unvisited, every unvisited cell looks for a frontier neighbour
+// instead, 64 cells per word (bottom up, as in Beamer's direction
+// optimizing BFS). Neighbouring cells share a mark byte, so workers
+// update marks with atomic xors.
+
+static const unsigned PBFS_CHUNK  = 512;  // frontier cells per top down work item
+static const unsigned PBFS_BAND   = 16;   // rows per bottom up work item
+static const unsigned PBFS_SERIAL = 4096; // smaller frontiers skip the pool
+static const unsigned PBFS_ALPHA  = 14;   // bottom up past unvisited / ALPHA
+static const unsigned PBFS_BETA   = 24;   // top down again below cells / BETA
+
+bool Solver::_claim(int x, int y)
+{
+    auto &w = m_visited[y * m_maze->stride + (x >> 6)];
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    if (w.load(std::memory_order_relaxed) & bit)
+        return false;
+    return !(w.fetch_or(bit, std::memory_order_relaxed) & bit);
+}
+
+void Solver::_mark(unsigned i, CellState from, CellState to)
+{
+    static_assert(sizeof(std::atomic<uint8_t>) == 1, "marks are updated in place");
+    auto *marks = reinterpret_cast<std::atomic<uint8_t> *>(m_maze->marks);
+    marks[i >> 2].fetch_xor((uint8_t)((from ^ to) << ((i & 3) << 1)), std::memory_order_relaxed);
+}
+
+// Directions are packed like the marks, and neighbouring cells may be
+// reached by different workers. Each cell is reached once, so its two
+// bits are cleared of an earlier search and set without a CAS loop.
+void Solver::_markDir(unsigned i, unsigned char d)
+{
+    auto *dirs = reinterpret_cast<std::atomic<uint8_t> *>(m_vertices.dir);
+    unsigned shift = (i & 3) << 1;
+    dirs[i >> 2].fetch_and((uint8_t)~(3 << shift), std::memory_order_relaxed);
+    dirs[i >> 2].fetch_or((uint8_t)(d << shift), std::memory_order_relaxed);
+}
+
+void Solver::_initParallelBFS()
+{
+    unsigned workers = threads ? threads : std::thread::hardware_concurrency();
+    workers = workers ? workers : 1;
+    if (!m_pool || m_pool->Size() != workers) {
+        delete m_pool;
+        delete [] m_lists;
+        m_pool  = new ThreadPool(workers);
+        m_lists = new Stack<unsigned>[2 * workers];
+    }
+    m_cur = m_lists;
+    m_nxt = m_lists + workers;
+    for (unsigned i = 0; i < 2 * workers; i ++)
+        m_lists[i].Clear();
+
+    unsigned n = m_maze->hcells, s = m_maze->stride;
+    size_t words = (size_t)s * m_maze->vcells;
+    if (words > m_bitmapWords) {
+        delete [] m_visited;
+        delete [] m_front;
+        delete [] m_next;
+        m_visited = new std::atomic<uint64_t>[words];
+        m_front = new uint64_t[words];
+        m_next  = new uint64_t[words];
+        m_bitmapWords = words;
+    }
+    // The frontiers are written before they are read, only the visited
+    // bits have to be cleared. The workers do that a band of rows at a
+    // time, counting the open cells as they go.
+    unsigned v = m_maze->vcells;
+    std::atomic<unsigned> rows{0};
+    std::atomic<size_t> open{0};
+    m_pool->Run([&](unsigned) {
+        size_t count = 0;
+        for (;;) {
+            unsigned y0 = rows.fetch_add(PBFS_BAND, std::memory_order_relaxed);
+            if (y0 >= v)
+                break;
+
+            unsigned y1 = y0 + PBFS_BAND < v ? y0 + PBFS_BAND : v;
+            for (size_t i = (size_t)y0 * s; i < (size_t)y1 * s; i ++) {
+                m_visited[i].store(0, std::memory_order_relaxed);
+                count += Bits::Count(~m_maze->walls[i] & Bits::RowMask(i % s, s, n));
+            }
         }
+        open.fetch_add(count, std::memory_order_relaxed);
+    });
+    m_unvisited = open;
 
-        if ((*m_maze)(x, y) == PATH) {
-            vert.hval = _heuristic(x, y, m_end.x, m_end.y);
-            Qitem q = {x, y, &vert};
-            m_queue.Enqueue(q);
-            (*m_maze)(x, y) = ACTIVE;
+    _claim(m_start.x, m_start.y);
+    m_cur[0].Push(m_start.y * n + m_start.x);
+    m_frontier = 1;
+    m_lastFrontier = 0;
+    m_unvisited --;
+    m_bottomUp = false;
+    (*m_maze)(m_start.x, m_start.y) = ACTIVE;
+}
+
+bool Solver::_stepParallelBFS()
+{
+    auto end = m_visited[m_end.y * m_maze->stride + (m_end.x >> 6)].load(std::memory_order_relaxed);
+    if ((end >> (m_end.x & 63)) & 1) {
+        m_active = {m_end.x, m_end.y};
+        return false;
+    }
+    if (m_frontier == 0)
+        return false;
+
+    // a bottom up level reads every word of the grid, so it also has to
+    // beat that fixed cost, not just the edges left unvisited
+    size_t cells = (size_t)m_maze->hcells * m_maze->vcells;
+    bool growing = m_frontier > m_lastFrontier;
+    if (!m_bottomUp && growing && m_frontier * PBFS_ALPHA > m_unvisited && m_frontier * 64 > cells)
+        _toBottomUp();
+    else if (m_bottomUp && !growing && m_frontier * PBFS_BETA < cells)
+        _toTopDown();
+
+    vertsExpanded += m_frontier;
+    m_lastFrontier = m_frontier;
+    unsigned workers = m_pool->Size();
+    size_t reached = 0;
+
+    if (m_bottomUp) {
+        if (m_maze->dirty)
+            m_maze->allDirty = true;
+
+        std::atomic<unsigned> rows{0};
+        std::atomic<size_t> count{0};
+        m_pool->Run([&](unsigned) { _bottomUp(rows, count); });
+        uint64_t *t = m_front; m_front = m_next; m_next = t;
+        reached = count;
+    } else {
+        for (unsigned w = 0; w < workers; w ++)
+            m_nxt[w].Clear();
+
+        // below a few thousand cells a level is cheaper than waking the pool
+        std::atomic<size_t> cursor{0};
+        if (m_frontier < PBFS_SERIAL) {
+            _topDown(0, m_maze->dirty != nullptr, cursor);
+        } else {
+            if (m_maze->dirty)
+                m_maze->allDirty = true;
+            m_pool->Run([&](unsigned w) { _topDown(w, false, cursor); });
         }
+
+        Stack<unsigned> *t = m_cur; m_cur = m_nxt; m_nxt = t;
+        for (unsigned w = 0; w < workers; w ++) {
+            if (!reached && !m_cur[w].IsEmpty())
+                m_active = {(int)(m_cur[w][0] % m_maze->hcells), (int)(m_cur[w][0] / m_maze->hcells)};
+            reached += m_cur[w].Size();
+        }
+    }
+
+    m_frontier = reached;
+    m_unvisited -= reached;
+    return true;
+}
+
+void Solver::_topDown(unsigned w, bool touch, std::atomic<size_t> &cursor)
+{
+    unsigned n = m_maze->hcells;
+    unsigned lists = m_pool->Size();
+    auto &next = m_nxt[w];
+
+    auto visit = [&](int x, int y, unsigned char dir) {
+        if (!m_maze->PointInBounds(x, y) || m_maze->IsWall(x, y) || !_claim(x, y))
+            return;
+
+        unsigned i = y * n + x;
+        _markDir(i, dir);
+        _mark(i, PATH, ACTIVE);
+        if (touch)
+            m_maze->Touch(x, y);
+        next.Push(i);
     };
 
-    (*m_maze)(i.x, i.y) = DEAD;
-    enqueue(i.x - 1, i.y, L);
-    enqueue(i.x + 1, i.y, R);
-    enqueue(i.x, i.y - 1, B);
-    enqueue(i.x, i.y + 1, T);
+    for (;;) {
+        // work items are chunks of one worker's list, numbered across lists
+        size_t k = cursor.fetch_add(1, std::memory_order_relaxed);
+        unsigned l = 0;
+        for (; l < lists; l ++) {
+            size_t chunks = (m_cur[l].Size() + PBFS_CHUNK - 1) / PBFS_CHUNK;
+            if (k < chunks)
+                break;
+            k -= chunks;
+        }
+        if (l == lists)
+            return;
+
+        unsigned first = k * PBFS_CHUNK;
+        unsigned last  = first + PBFS_CHUNK < m_cur[l].Size() ? first + PBFS_CHUNK : m_cur[l].Size();
+        for (unsigned j = first; j < last; j ++) {
+            unsigned i = m_cur[l][j];
+            int x = i % n;
+            int y = i / n;
+            _mark(i, ACTIVE, DEAD);
+            if (touch)
+                m_maze->Touch(x, y);
+
+            visit(x - 1, y, L);
+            visit(x + 1, y, R);
+            visit(x, y - 1, B);
+            visit(x, y + 1, T);
+        }
+    }
+}
+
+void Solver::_bottomUp(std::atomic<unsigned> &cursor, std::atomic<size_t> &count)
+{
+    unsigned n = m_maze->hcells, s = m_maze->stride, v = m_maze->vcells;
+    size_t reached = 0;
+
+    for (;;) {
+        unsigned y0 = cursor.fetch_add(PBFS_BAND, std::memory_order_relaxed);
+        if (y0 >= v)
+            break;
+
+        unsigned y1 = y0 + PBFS_BAND < v ? y0 + PBFS_BAND : v;
+        for (unsigned y = y0; y < y1; y ++) {
+            const uint64_t *f = m_front + (size_t)y * s;
+            for (unsigned i = 0; i < s; i ++) {
+                size_t at = (size_t)y * s + i;
+                unsigned base = y * n + i * 64;
+
+                // frontier neighbours to the left, right, above and below,
+                // named after the move that reaches this cell from them
+                uint64_t r = f[i] << 1 | (i > 0 ? f[i - 1] >> 63 : 0);
+                uint64_t l = f[i] >> 1 | (i + 1 < s ? f[i + 1] << 63 : 0);
+                uint64_t t = y > 0 ? (f - s)[i] : 0;
+                uint64_t b = y + 1 < v ? (f + s)[i] : 0;
+
+                uint64_t open = ~m_maze->walls[at] & Bits::RowMask(i, s, n);
+                uint64_t seen = m_visited[at].load(std::memory_order_relaxed);
+                uint64_t reach = open & ~seen & (l | r | t | b);
+                m_next[at] = reach;
+
+                for (uint64_t d = f[i]; d; d &= d - 1)
+                    _mark(base + Bits::LowestSet(d), ACTIVE, DEAD);
+                if (!reach)
+                    continue;
+
+                m_visited[at].store(seen | reach, std::memory_order_relaxed);
+                reached += Bits::Count(reach);
+                for (uint64_t d = reach; d; d &= d - 1) {
+                    unsigned j = Bits::LowestSet(d);
+                    uint64_t bit = (uint64_t)1 << j;
+                    _markDir(base + j, (r & bit) ? R : (l & bit) ? L : (t & bit) ? T : B);
+                    _mark(base + j, PATH, ACTIVE);
+                }
+            }
+        }
+    }
+    count.fetch_add(reached, std::memory_order_relaxed);
+}
+
+void Solver::_toBottomUp()
+{
+    unsigned n = m_maze->hcells, s = m_maze->stride;
+    memset(m_front, 0, (size_t)s * m_maze->vcells * sizeof(*m_front));
+    for (unsigned w = 0; w < m_pool->Size(); w ++) {
+        for (unsigned j = 0; j < m_cur[w].Size(); j ++) {
+            unsigned i = m_cur[w][j];
+            unsigned x = i % n, y = i / n;
+            m_front[(size_t)y * s + (x >> 6)] |= (uint64_t)1 << (x & 63);
+        }
+    }
+    m_bottomUp = true;
+}
+
+void Solver::_toTopDown()
+{
+    unsigned n = m_maze->hcells, s = m_maze->stride, v = m_maze->vcells;
+    std::atomic<unsigned> rows{0};
+    m_pool->Run([&](unsigned w) {
+        auto &list = m_cur[w];
+        list.Clear();
+        for (;;) {
+            unsigned y0 = rows.fetch_add(PBFS_BAND, std::memory_order_relaxed);
+            if (y0 >= v)
+                break;
+
+            unsigned y1 = y0 + PBFS_BAND < v ? y0 + PBFS_BAND : v;
+            for (unsigned y = y0; y < y1; y ++)
+                for (unsigned i = 0; i < s; i ++)
+                    for (uint64_t d = m_front[(size_t)y * s + i]; d; d &= d - 1)
+                        list.Push(y * n + i * 64 + Bits::LowestSet(d));
+        }
+    });
+    m_bottomUp = false;
+}
+
+////////////////////////////////
+// Wavefront
+////////////////////////////////
+
+// Breadth first search run by the FloodFill engine, one wave per step.
+// The path is read back from its phase plane rather than from
+// m_vertices, which this type does not allocate.
+
+void Solver::_initWavefront()
+{
+    m_flood = new FloodFill;
+    m_flood->Init(m_maze, FloodFill::MARK);
+}
+
+bool Solver::_stepWavefront()
+{
+    if (m_flood->Reached(m_end.x, m_end.y)) {
+        m_active = {m_end.x, m_end.y};
+        return false;
+    }
+
+    size_t n = m_flood->Step();
+    vertsExpanded += n;
+    return n != 0;
+}
+
+////////////////////////////////
+
+// A fill from the end instead of the start, run over the whole maze so
+// any start can be answered from it until the walls or the end change.
+
+bool Solver::_fieldReady()
+{
+    auto &k = m_fieldKey;
+    return k.maze == m_maze->id && k.w == m_maze->hcells && k.h == m_maze->vcells
+        && k.wallEdits == m_maze->wallEdits && k.x == m_end.x && k.y == m_end.y;
+}
+
+void Solver::_initDistanceField()
+{
+    if (_fieldReady())
+        return;
+    m_fieldKey = {};
+    if (!m_field)
+        m_field = new FloodFill;
+    m_field->Init(m_maze, FloodFill::MARK | FloodFill::FROM_END);
+}
+
+bool Solver::_stepDistanceField()
+{
+    if (!_fieldReady()) {
+        size_t n = m_field->Step();
+        vertsExpanded += n;
+        if (n)
+            return true;
+        m_fieldKey = {m_maze->id, m_maze->hcells, m_maze->vcells, m_maze->wallEdits, m_end.x, m_end.y};
+    }
+    m_active = {m_start.x, m_start.y};
+    return false;
+}
+
+////////////////////////////////
+
+// Keeps its search between solves and, after walls change, only expands
+// the cells whose distance the change affected, see LPAStar.
+
+void Solver::Changed(Maze *maze, int x, int y, unsigned long long before)
+{
+    if (m_lpa)
+        m_lpa->log.Log(maze, x, y, before);
+    if (m_hpa)
+        m_hpa->log.Log(maze, x, y, before);
+    if (m_junctions)
+        m_junctions->log.Log(maze, x, y, before);
+}
+
+void Solver::_initLifelongAStar()
+{
+    if (!m_lpa)
+        m_lpa = new LPAStar;
+    m_lpa->Init(m_maze, _heuristic);
+}
+
+bool Solver::_stepLifelongAStar()
+{
+    if (!m_lpa->Step()) {
+        m_active = {m_end.x, m_end.y};
+        return false;
+    }
+    vertsExpanded ++;
+    m_active = {m_lpa->x, m_lpa->y};
+    return true;
+}
+
+////////////////////////////////
+
+// A* over a graph of cluster entrances, refined to cells once a path is
+// found, see HPAStar. vertsExpanded counts the graph nodes and the cells
+// of the cluster searches.
+
+void Solver::_initHierarchical()
+{
+    if (!m_hpa)
+        m_hpa = new HPAStar;
+    m_hpa->Init(m_maze, _heuristic);
+    if (timeFlat)
+        m_hpa->TimeFlat();
+    hierarchy = {m_hpa->clusters, m_hpa->rebuilt, m_hpa->nodes, m_hpa->edges, m_hpa->buildMs, m_hpa->queryMs, m_hpa->flatMs};
+    vertsExpanded = m_hpa->searched;
+}
+
+bool Solver::_stepHierarchical()
+{
+    bool more = m_hpa->Step();
+    vertsExpanded = m_hpa->searched;
+    hierarchy.queryMs = m_hpa->queryMs;
+    m_active = {m_hpa->x, m_hpa->y};
+    return more;
+}
+
+////////////////////////////////
+
+// A* over junctions and dead ends only, corridors are single weighted
+// edges, see JunctionGraph.
+
+void Solver::_initJunction()
+{
+    if (!m_junctions)
+        m_junctions = new JunctionGraph;
+    m_junctions->Init(m_maze, _heuristic);
+    m_active = {m_start.x, m_start.y};
+}
+
+bool Solver::_stepJunction()
+{
+    if (!m_junctions->Step()) {
+        m_active = {m_end.x, m_end.y};
+        return false;
+    }
+    vertsExpanded ++;
+    m_active = {m_junctions->x, m_junctions->y};
     return true;
 }
@@ -1,13 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
 #include "stack.hpp"
 #include "queue.hpp"
+#include "minheap.hpp"
+#include "buckets.hpp"
+#include "heuristic.hpp"
 
 struct Maze;
+class ThreadPool;
+class FloodFill;
+class LPAStar;
+class HPAStar;
+class JunctionGraph;
+enum CellState : unsigned char;
 
 class Solver {
 public:
-    typedef float (*Heuristic)(int x0, int y0, int x1, int y1);
+    typedef Heuristics::Func Heuristic;
 
     enum Type {
         AStar,
@@ -15,6 +27,15 @@ public:
         DepthFirst,
         BreadthFirst,
         GreedyBestFirst,
+        BidirectionalBFS,
+        BidirectionalAStar,
+        JumpPoint,
+        ParallelBFS,
+        Wavefront,
+        DistanceField,
+        LifelongAStar,
+        Hierarchical,
+        Junction,
     };
 
      Solver();
@@ -24,27 +45,96 @@ public:
     bool Step();
     bool StepAndTrace();
 
+    // Runs up to n steps, or as many as fit in budget, in one tight loop
+    // and returns how many ran. StepAndTrace only redraws the active path
+    // once per batch.
+    unsigned Step(unsigned n);
+    unsigned StepAndTrace(unsigned n);
+    unsigned RunFor(std::chrono::nanoseconds budget);
+    bool Finished() { return m_finished; }
+
+    // Lets the incremental solvers repair what they kept of their last
+    // search around a wall written in maze, instead of starting over.
+    // before is the wall edit count of the maze from just before the write.
+    void Changed(Maze *maze, int x, int y, unsigned long long before);
+
+    // worker threads of the parallel solvers, 0 runs one per core
+    unsigned threads = 0;
+    // the hierarchical solver also times plain A* on each new query, for
+    // hierarchy.flatMs
+    bool timeFlat = false;
+
+    bool found = false;
     unsigned pathLength = 0;
+    unsigned pathCost = 0; // summed weights of the cells stepped onto
     unsigned vertsExpanded = 0;
 
+    // cluster graph of the hierarchical solver, as of its last Init
+    struct Hierarchy {
+        unsigned clusters = 0;
+        unsigned rebuilt = 0; // clusters, by the last Init
+        unsigned nodes = 0;
+        unsigned edges = 0;
+        float buildMs = 0;    // spent rebuilding them
+        float queryMs = 0;    // spent on the query so far
+        float flatMs = 0;     // plain A* on the same query, with timeFlat
+    } hierarchy;
+
 private:
-    Maze *m_maze;
-    bool m_finished = false;
+    Maze *m_maze = nullptr;
+    bool m_finished = true;
+    Type m_type = AStar;
 
     struct { int x, y; } m_end;
     struct { int x, y; } m_start;
     struct { int x, y; } m_active;
+    bool m_activeReverse = false;
 
     Heuristic _heuristic = nullptr;
 
+    // The heuristic of a step kernel, H when given so that it inlines into
+    // the kernel, _heuristic when null.
+    template <Heuristic H>
+    float _h(int x0, int y0, int x1, int y1);
+
     enum Direction : unsigned char {L, R, B, T};
 
-    struct VertexData {
-        float gval = -1;
-        float hval = -1;
-        unsigned char dir = 0;
+    // Search state, one array per field so the g values the informed
+    // solvers touch most lie densely: g as an integer step count, INF
+    // until reached, and the direction each cell was reached by, packed
+    // four cells to a byte like the mark plane. h is not kept, the
+    // inlined heuristic computes it again when a cell is queued. The open
+    // sets keep no per-cell index either, so a search takes 4.25 bytes a
+    // cell with g, 0.25 without, plus 12 bytes per queued entry.
+    //
+    // The arrays outlive a search and are never cleared for the next one.
+    // g is stored offset by m_base, the generation of the current search,
+    // and whatever lies below it was left by an earlier one and reads as
+    // INF. Reaching a cell sets both its g and its direction, so stale
+    // directions are never followed. The uninformed solvers keep g at 0
+    // as their visited flag.
+    static constexpr unsigned INF = ~0u;
+    struct Vertices {
+        unsigned *g = nullptr;
+        uint8_t *dir = nullptr;
+        size_t cells = 0;
     };
-    VertexData *m_vertices = nullptr;
+    Vertices m_vertices;
+    Vertices m_rvertices; // search from the end, bidirectional only
+    unsigned m_base = 1;
+    unsigned m_span = 0;  // bound on the g of the current search
+
+    // best known meeting of the two searches, the edge (a, b) where a was
+    // reached from the start and b from the end
+    struct {
+        bool found;
+        float cost;
+        struct { int x, y; } a, b;
+    } m_meet = {};
+
+    // jump point search scales h by 1 + m_tie to break f ties toward deeper
+    // nodes; h * m_tie stays below one step, so paths remain shortest
+    float m_tie = 0;
 
     struct Sitem {
         int x, y;
@@ -52,27 +142,119 @@ private:
 
     struct Qitem {
         int x, y;
-        VertexData *v;
     };
 
     Stack<Sitem> m_stack;
     Queue<Qitem> m_queue;
+    // open cells of greedy, bidirectional A* and jump point search, keyed by
+    // f, with the g they were queued at
+    struct Hitem {
+        float f;
+        unsigned i, g;
+        bool operator<(const Hitem &o) const { return f < o.f; }
+    };
+    MinHeap<Hitem> m_heap;
+    // open cells of Dijkstra and A*, with the g they were queued at
+    struct Bitem {
+        unsigned i, g;
+    };
+    Buckets<Bitem> m_buckets;
+    Queue<Qitem> m_rqueue;
+    MinHeap<Hitem> m_rheap;
+
+    // Parallel BFS keeps its frontier as one cell list per worker while
+    // expanding top down, and as a bitmap laid out like Maze::walls while
+    // expanding bottom up. Lists for the current and next level are kept
+    // in m_lists. The pool, lists and bitmaps survive across Init, the
+    // bitmaps are only allocated again for a larger maze.
+    ThreadPool *m_pool = nullptr;
+    Stack<unsigned> *m_lists = nullptr;
+    Stack<unsigned> *m_cur = nullptr;
+    Stack<unsigned> *m_nxt = nullptr;
+    std::atomic<uint64_t> *m_visited = nullptr;
+    uint64_t *m_front = nullptr;
+    uint64_t *m_next = nullptr;
+    size_t m_bitmapWords = 0; // allocated for each bitmap
+    bool m_bottomUp = false;
+    size_t m_frontier = 0;
+    size_t m_lastFrontier = 0;
+    size_t m_unvisited = 0;
+
+    FloodFill *m_flood = nullptr;
+
+    // Wavefront from the end over every open cell, kept across Init along
+    // with the maze id, size, wall count and end it was built for. While
+    // those hold, a solve from any start only walks its path.
+    FloodFill *m_field = nullptr;
+    struct {
+        unsigned long long maze; // Maze::id
+        unsigned w, h;
+        unsigned long long wallEdits;
+        int x, y;
+    } m_fieldKey = {};
+
+    LPAStar *m_lpa = nullptr; // kept across Init, like the field
+    HPAStar *m_hpa = nullptr; // likewise
+    JunctionGraph *m_junctions = nullptr; // likewise
 
     void _reset();
+    void _finish();
+
+    template <bool (Solver::*S)()>
+    unsigned _run(unsigned n);
 
     void _initAStar();
     void _initDijkstra();
     void _initDepthFirst();
     void _initBreadthFirst();
     void _initGreedyBestFirst();
+    void _initBidirectionalBFS();
+    void _initBidirectionalAStar();
+    void _initJumpPoint();
+    void _initParallelBFS();
+    void _initWavefront();
+    void _initDistanceField();
+    void _initLifelongAStar();
+    void _initHierarchical();
+    void _initJunction();
 
-    bool (Solver::*_step)() = nullptr;
-    bool _stepAStar();
-    bool _stepDijkstra();
+    template <Heuristic H> bool _stepAStar();
     bool _stepDepthFirst();
     bool _stepBreadthFirst();
-    bool _stepGreedyBestFirst();
+    template <Heuristic H> bool _stepGreedyBestFirst();
+    bool _stepBidirectionalBFS();
+    template <Heuristic H> bool _stepBidirectionalAStar();
+    template <Heuristic H> bool _stepJumpPoint();
+
+    bool _jumpH(int x, int y, int dx, int &jx);
+    bool _jumpV(int x, int y, int dy, int &jy);
+    unsigned _walkJumps(int x, int y, CellState t, unsigned &cost);
+
+    bool _stepParallelBFS();
+    bool _claim(int x, int y);
+    void _mark(unsigned i, CellState from, CellState to);
+    void _markDir(unsigned i, unsigned char d);
+    void _topDown(unsigned w, bool touch, std::atomic<size_t> &cursor);
+    void _bottomUp(std::atomic<unsigned> &cursor, std::atomic<size_t> &count);
+    void _toBottomUp();
+    void _toTopDown();
+
+    bool _stepWavefront();
+    bool _stepDistanceField();
+    bool _fieldReady();
+    bool _stepLifelongAStar();
+    bool _stepHierarchical();
+    bool _stepJunction();
 
     bool _isEnd(int x, int y);
-    void _trace(unsigned);
+    void _meetAt(bool forward, int x0, int y0, int x1, int y1, float cost);
+    void _alloc(Vertices &v);
+    void _free(Vertices &v);
+    void _generation();
+    unsigned _g(const Vertices &v, unsigned i);
+    void _setG(Vertices &v, unsigned i, unsigned g);
+    static unsigned char _dir(const Vertices &v, unsigned i);
+    static void _setDir(Vertices &v, unsigned i, unsigned char d);
+    unsigned _walk(int x, int y, const Vertices &v, int tx, int ty, CellState t, unsigned &cost);
+    unsigned _trace(CellState);
 };
@@ -5,43 +5,55 @@
 template <typename T>
 class Stack {
 public:
-    Stack() : top(nullptr) {}
-    ~Stack() { Clear(); }
+    Stack() : data(nullptr), top(0), capacity(0) {}
+    ~Stack() { delete [] data; }
 
     void Push(const T &s) {
-        Node *n = new Node();
-        n->data = s;
-        n->next = top;
-        top = n;
+        if (top == capacity)
+            Reserve(capacity ? capacity * 2 : 64);
+        data[top ++] = s;
     }
 
     T Pop() {
-        assert(top != nullptr);
-        Node *tmp = top;
-        T r = top->data;
-        top = top->next;
-        delete tmp;
-        return r;
+        assert(top != 0);
+        return data[-- top];
     }
 
     T &Peek() {
-        assert(top != nullptr);
-        return top->data;
+        assert(top != 0);
+        return data[top - 1];
     }
 
     bool IsEmpty() {
-        return top == nullptr;
+        return top == 0;
+    }
+
+    unsigned Size() {
+        return top;
+    }
+
+    T &operator[](unsigned i) {
+        assert(i < top);
+        return data[i];
     }
 
     void Clear() {
-        while (!IsEmpty())
-            Pop();
+        top = 0;
+    }
+
+    void Reserve(unsigned n) {
+        if (n <= capacity)
+            return;
+        T *d = new T[n];
+        for (unsigned i = 0; i < top; i ++)
+            d[i] = data[i];
+        delete [] data;
+        data = d;
+        capacity = n;
     }
 
 private:
-    struct Node {
-        T data;
-        Node *next;
-    };
-    Node *top;
+    T *data;
+    unsigned top;
+    unsigned capacity;
 };
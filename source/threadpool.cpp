@@ -0,0 +1,62 @@
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned n)
+{
+    m_size = n ? n : 1;
+    m_threads = new std::thread[m_size - 1];
+    for (unsigned i = 1; i < m_size; i ++)
+        m_threads[i - 1] = std::thread(&ThreadPool::_worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+    for (unsigned i = 1; i < m_size; i ++)
+        m_threads[i - 1].join();
+    delete [] m_threads;
+}
+
+void ThreadPool::_run(Job job, const void *ctx)
+{
+    if (m_size > 1) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_ctx = ctx;
+        m_pending = m_size - 1;
+        m_generation ++;
+    }
+    m_wake.notify_all();
+
+    job(ctx, 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+void ThreadPool::_worker(unsigned w)
+{
+    unsigned long seen = 0;
+    for (;;) {
+        Job job;
+        const void *ctx;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seen] { return m_quit || m_generation != seen; });
+            if (m_quit)
+                return;
+            seen = m_generation;
+            job = m_job;
+            ctx = m_ctx;
+        }
+
+        job(ctx, w);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (-- m_pending == 0)
+            m_done.notify_one();
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Fixed set of worker threads running one fork-join job at a time. The
+// calling thread takes part as worker 0, so a pool of one starts no
+// threads at all.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned n);
+    ~ThreadPool();
+
+    unsigned Size() { return m_size; }
+
+    // Calls f(worker) once for every worker in [0, Size()) and returns
+    // when all of them are done.
+    template <typename F>
+    void Run(const F &f) {
+        _run([](const void *c, unsigned w) { (*(const F *)c)(w); }, &f);
+    }
+
+private:
+    typedef void (*Job)(const void *ctx, unsigned worker);
+
+    unsigned m_size = 1;
+    std::thread *m_threads = nullptr;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    Job m_job = nullptr;
+    const void *m_ctx = nullptr;
+    unsigned long m_generation = 0;
+    unsigned m_pending = 0;
+    bool m_quit = false;
+
+    void _run(Job job, const void *ctx);
+    void _worker(unsigned w);
+};
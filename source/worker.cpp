@@ -0,0 +1,297 @@
+#include "worker.hpp"
+#include "bits.hpp"
+
+#include <math.h>
+#include <chrono>
+#include <initializer_list>
+
+// work done between two looks at the command ring, and between two
+// publications, also the most an animation batch may take
+static constexpr std::chrono::milliseconds SLICE(8);
+
+Worker::Worker(Maze &front)
+    : m_front(front)
+    , m_work(front.hcells, front.vcells)
+    , m_shared(front.hcells, front.vcells)
+{
+    m_solver.timeFlat = true;
+    m_front.allDirty = true;
+    m_work.CopyDirty(m_front);
+    m_shared.CopyDirty(m_work);
+    m_front.allDirty = true;
+    m_thread = std::thread(&Worker::_main, this);
+}
+
+Worker::~Worker()
+{
+    m_quit = true;
+    Send({Command::Quit});
+    m_thread.join();
+    delete [] m_marked;
+    delete [] m_markedRows;
+}
+
+bool Worker::Send(const Command &c)
+{
+    bool job = c.kind == Command::Generate || c.kind == Command::Solve;
+    assert(!job || !busy);
+    if (!m_commands.Push(c))
+        return false;
+    busy = busy || job;
+
+    // taking the mutex orders the push before the worker's last look at
+    // the ring, so the wakeup cannot be lost
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_wake.notify_one();
+    return true;
+}
+
+bool Worker::Receive()
+{
+    if (!m_ready.load(std::memory_order_acquire))
+        return false;
+
+    m_front.CopyDirty(m_shared);
+    progress = m_published;
+    busy = progress.running;
+    m_ready.store(false, std::memory_order_release);
+    return true;
+}
+
+bool Worker::Load(const char *path, MazeInfo *info)
+{
+    assert(!busy);
+    if (!m_front.Load(path, info))
+        return false;
+
+    for (Maze *m : {&m_work, &m_shared}) {
+        // the file changed in between, copy the front instead
+        if (!m->Load(path)) {
+            m->Resize(m_front.hcells, m_front.vcells);
+            m_front.allDirty = true;
+            m->CopyDirty(m_front);
+        }
+    }
+    m_front.allDirty = true;
+    return true;
+}
+
+void Worker::Paint(int x, int y, CellState s)
+{
+    auto before = m_work.wallEdits;
+    Edit([x, y, s](Maze &m) { m(x, y) = s; });
+    m_solver.Changed(&m_work, x, y, before);
+}
+
+void Worker::Terrain(int x, int y, unsigned w)
+{
+    Edit([x, y, w](Maze &m) { m.SetWeight(x, y, w); });
+}
+
+void Worker::_main()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return !m_commands.IsEmpty(); });
+        }
+
+        Command c;
+        while (m_commands.Pop(c)) {
+            switch (c.kind) {
+            case Command::Quit:
+                return;
+            case Command::Generate:
+            case Command::Solve:
+                _run(c);
+                break;
+            case Command::Animate:
+                m_animate = c.animate;
+                m_rate = c.rate;
+                break;
+            case Command::Cancel:
+                break;
+            }
+        }
+
+        if (m_quit)
+            return;
+    }
+}
+
+// Applies the commands that arrived mid job, returns false once the job
+// should stop.
+bool Worker::_poll(Progress &p)
+{
+    Command c;
+    while (m_commands.Pop(c)) {
+        if (c.kind == Command::Animate) {
+            m_animate = c.animate;
+            m_rate = c.rate;
+        } else if (c.kind == Command::Cancel || c.kind == Command::Quit) {
+            p.cancelled = true;
+        }
+    }
+    return !p.cancelled && !m_quit;
+}
+
+void Worker::_run(const Command &job)
+{
+    using clock = std::chrono::steady_clock;
+    bool generating = job.kind == Command::Generate;
+
+    if (generating) {
+        m_generator.Init(&m_work, (Generator::Type)job.type, job.seed);
+    } else {
+        // the marks are only cleared for display, solvers keep no state there
+        _clearMarks();
+        m_solver.Init(&m_work, (Solver::Type)job.type, job.heuristic);
+        if (m_openEdits != m_work.wallEdits) {
+            m_open = 0;
+            for (unsigned y = 0; y < m_work.vcells; y ++)
+                for (unsigned i = 0; i < m_work.stride; i ++)
+                    m_open += Bits::Count(~m_work.walls[(size_t)y * m_work.stride + i] & Bits::RowMask(i, m_work.stride, m_work.hcells));
+            m_openEdits = m_work.wallEdits;
+        }
+    }
+    size_t open = m_open;
+    m_animate = job.animate;
+    m_rate = job.rate;
+    m_cost = 0;
+
+    Progress p;
+    p.running = true;
+    auto start = clock::now(), then = start;
+    double due = 0;
+
+    while (_poll(p)) {
+        if (m_animate) {
+            // Steps fall due at m_rate per second. A batch runs what is due
+            // but no more than fits in a slice at the measured cost per
+            // step, what does not fit is dropped so a slow maze animates
+            // slower rather than stalling.
+            auto now = clock::now();
+            std::chrono::duration<double> d = now - then;
+            then = now;
+            double cap = m_cost > 0 ? std::chrono::nanoseconds(SLICE).count() / m_cost : 64;
+            due = fmin(due + d.count() * m_rate, fmax(cap, 1));
+
+            unsigned n = (unsigned)due;
+            unsigned ran = generating ? m_generator.Step(n) : m_solver.StepAndTrace(n);
+            if (ran) {
+                std::chrono::duration<double, std::nano> t = clock::now() - now;
+                double cost = t.count() / ran;
+                m_cost = m_cost > 0 ? m_cost + (cost - m_cost) / 4 : cost;
+            }
+            due -= n;
+            p.steps += ran;
+        } else {
+            p.steps += generating ? m_generator.RunFor(SLICE) : m_solver.RunFor(SLICE);
+            then = clock::now();
+            due = 0;
+        }
+
+        std::chrono::duration<float, std::milli> elapsed = clock::now() - start;
+        p.ms = elapsed.count();
+        if (generating) {
+            p.setCount = m_generator.setCount;
+            p.setHeight = m_generator.setHeight;
+        } else {
+            p.found = m_solver.found;
+            p.pathLength = m_solver.pathLength;
+            p.pathCost = m_solver.pathCost;
+            p.vertsExpanded = m_solver.vertsExpanded;
+            p.hierarchy = m_solver.hierarchy;
+            p.explored = open ? fminf(1.0f, (float)m_solver.vertsExpanded / open) : 1.0f;
+        }
+
+        if (generating ? m_generator.Finished() : m_solver.Finished())
+            break;
+        _publish(p, false);
+
+        // sleep until the next step is due, or a command comes in
+        if (m_animate && due < 1) {
+            auto next = then + std::chrono::duration<double>((1 - due) / m_rate);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait_until(lock, std::chrono::time_point_cast<clock::duration>(next), [this] {
+                return !m_commands.IsEmpty();
+            });
+        }
+    }
+
+    p.running = false;
+    _publish(p, true);
+}
+
+// Adds the dirty spans of m_work to m_marked, before they are cleared.
+void Worker::_gatherMarks()
+{
+    if (m_markedAll || m_work.allDirty) {
+        m_markedAll = true;
+        return;
+    }
+
+    for (unsigned i = 0; i < m_work.ndirty; i ++) {
+        unsigned y = m_work.dirtyRows[i];
+        Maze::Span d = m_work.dirty[y];
+        Maze::Span &s = m_marked[y];
+        if (s.lo > s.hi) {
+            s = d;
+            m_markedRows[m_nmarked ++] = y;
+        } else {
+            s.lo = d.lo < s.lo ? d.lo : s.lo;
+            s.hi = d.hi > s.hi ? d.hi : s.hi;
+        }
+    }
+}
+
+// Clears the marks of m_work left by the jobs since the last clear. Only
+// the spans they wrote are cleared and published, not the whole maze,
+// unless m_work was dirty as a whole in between.
+void Worker::_clearMarks()
+{
+    _gatherMarks();
+    if (m_markedAll) {
+        if (m_markedSize != m_work.vcells) {
+            delete [] m_marked;
+            delete [] m_markedRows;
+            m_marked = new Maze::Span[m_work.vcells];
+            m_markedRows = new unsigned[m_work.vcells];
+            m_markedSize = m_work.vcells;
+        }
+        for (unsigned y = 0; y < m_work.vcells; y ++)
+            m_marked[y] = {1, 0};
+        m_work.ClearPaths();
+    } else {
+        for (unsigned i = 0; i < m_nmarked; i ++) {
+            unsigned y = m_markedRows[i];
+            m_work.ClearPaths(y, m_marked[y]);
+            m_marked[y] = {1, 0};
+        }
+    }
+    m_nmarked = 0;
+    m_markedAll = false;
+
+    // The cleared cells go to m_shared now rather than with the first
+    // publication, so they are not taken for marks of this job. The UI
+    // thread took the last publication before sending the job.
+    assert(!m_ready.load(std::memory_order_acquire));
+    m_shared.CopyDirty(m_work);
+}
+
+// Hands the cells written since the last publication over to the UI
+// thread, unless it has not taken the previous one yet. The last one of a
+// job waits for it, the UI only leaves the busy state through it.
+void Worker::_publish(const Progress &p, bool last)
+{
+    while (m_ready.load(std::memory_order_acquire)) {
+        if (!last || m_quit)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    _gatherMarks();
+    m_shared.CopyDirty(m_work);
+    m_published = p;
+    m_ready.store(true, std::memory_order_release);
+}
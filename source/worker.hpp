@@ -0,0 +1,128 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "maze.hpp"
+#include "ring.hpp"
+#include "solver.hpp"
+#include "generator.hpp"
+
+// Runs generators and solvers on a thread of its own so the window keeps
+// drawing while they work. Commands reach it through a lock free ring.
+//
+// The worker writes a private copy of the maze. Between batches it copies
+// the cells it wrote, and its progress, into a second copy, as long as
+// the UI thread has taken the previous publication. Receive merges that
+// into the front maze, the one the UI thread draws and owns outright.
+// All three copies agree outside of the cells in flight.
+//
+// While no job runs the worker touches neither of its copies, which is
+// when the UI thread may change the maze, through Edit.
+class Worker {
+public:
+    struct Command {
+        enum Kind {
+            Generate,
+            Solve,
+            Animate, // change the animation settings, also mid job
+            Cancel,
+            Quit,
+        } kind;
+
+        int type = 0; // Generator::Type or Solver::Type
+        unsigned long long seed = 0; // of the generator
+        Solver::Heuristic heuristic = nullptr;
+        bool animate = true;
+        unsigned rate = 60; // steps per second when animating
+    };
+
+    struct Progress {
+        bool running = false;
+        bool cancelled = false;
+        unsigned steps = 0;
+        float ms = 0;
+        float explored = 0; // fraction of the open cells, solvers only
+
+        unsigned setCount = 0;
+        unsigned setHeight = 0;
+
+        bool found = false;
+        unsigned pathLength = 0;
+        unsigned pathCost = 0;
+        unsigned vertsExpanded = 0;
+        Solver::Hierarchy hierarchy;
+    };
+
+    explicit Worker(Maze &front);
+    ~Worker();
+
+    // Generate and Solve may only be sent while not busy.
+    bool Send(const Command &c);
+    // Merges the latest publication into the front maze and progress,
+    // returns false when there was none.
+    bool Receive();
+
+    // Maps the file into all three copies, which share its pages until
+    // they write them.
+    bool Load(const char *path, MazeInfo *info);
+
+    // Writes one cell of every copy and tells the solver, which may then
+    // repair its last search around it.
+    void Paint(int x, int y, CellState s);
+    // Sets the terrain cost of one cell of every copy. Walls stay as they
+    // are, so the solver has nothing to repair.
+    void Terrain(int x, int y, unsigned w);
+
+    template <typename F>
+    void Edit(F f) {
+        assert(!busy);
+        f(m_front);
+        f(m_work);
+        f(m_shared);
+    }
+
+    // UI thread side, a job was sent and its last publication not received
+    bool busy = false;
+    Progress progress;
+
+private:
+    Maze &m_front;
+    Maze m_work;
+    Maze m_shared;
+    Progress m_published;
+    std::atomic<bool> m_ready{false}; // m_shared holds a publication
+
+    Ring<Command, 64> m_commands;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_quit{false};
+
+    Generator m_generator;
+    Solver m_solver;
+    bool m_animate = true;
+    unsigned m_rate = 60;
+    double m_cost = 0; // ns per step, moving average over the job
+
+    // Cells of m_work written since its marks were last cleared, as one
+    // span per row like Maze::dirty, gathered from its dirty spans before
+    // each publication. All of them once it was dirty as a whole.
+    Maze::Span *m_marked = nullptr;
+    unsigned *m_markedRows = nullptr;
+    unsigned m_nmarked = 0;
+    unsigned m_markedSize = 0; // rows of m_marked
+    bool m_markedAll = true;
+
+    // open cells of m_work, counted again only once its walls change
+    size_t m_open = 0;
+    unsigned long long m_openEdits = ~0ull;
+
+    void _main();
+    void _run(const Command &job);
+    bool _poll(Progress &p);
+    void _gatherMarks();
+    void _clearMarks();
+    void _publish(const Progress &p, bool last);
+};